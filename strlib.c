@@ -3,7 +3,20 @@
 #include <stdio.h>
 #include <stdlib.h>  // For malloc and free
 #include <string.h>  // For strncpy, strncat, and strcmp
+#include <stdint.h>  // For fixed-width kernel types
+#include <stdatomic.h> // For publishing the bound kernel table
 #include "strlib.h"
+#include "strlib_normalize_tables.h"
+#include "strlib_casefold_tables.h"
+#include "strlib_grapheme_tables.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define STR_X86_DISPATCH 1
+#include <immintrin.h> // For SSE4.2 / AVX2 / AVX-512 intrinsics
+#define STR_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define STR_TARGET_AVX2 __attribute__((target("avx2")))
+#define STR_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#endif
 
 // List of common Unicode whitespace code points
 const int unicodeWhitespace[] = { 
@@ -14,540 +27,4056 @@ const int unicodeWhitespace[] = {
 
 StrError str_last_error = STR_SUCCESS;
 
-// Copies characters from src to dest from start to end
-StrError str_copyRange(const char* src, int start, int end, char* dest) {
-    if (!src || !dest) return (str_last_error = STR_ERROR_NULL_INPUT);
-    
-    int i = 0;
-    while (*src && i < start) {
-        str_getUTF8CodePoint(&src);
-        i++;
-    }
-    
-    while (*src && i < end) {
-        const char* srcStart = src;
-        str_getUTF8CodePoint(&src);
-        int len = src - srcStart;
-        strncpy(dest, srcStart, len);
-        dest += len;
-        i++;
-    }
-    
-    *dest = '\0';
-    return (str_last_error = STR_SUCCESS);
+const uint8_t str_utf8Dfa[364] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    8, 8, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    10, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 4, 3, 3, 11, 6, 6, 6, 5, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+     0, 12, 24, 36, 60, 96, 84, 12, 12, 12, 48, 72,
+    12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+    12,  0, 12, 12, 12, 12, 12,  0, 12,  0, 12, 12,
+    12, 24, 12, 12, 12, 12, 12, 24, 12, 24, 12, 12,
+    12, 12, 12, 12, 12, 12, 12, 24, 12, 12, 12, 12,
+    12, 24, 12, 12, 12, 12, 12, 12, 12, 24, 12, 12,
+    12, 12, 12, 12, 12, 12, 12, 36, 12, 36, 12, 12,
+    12, 36, 12, 12, 12, 12, 12, 36, 12, 36, 12, 12,
+    12, 36, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+};
+
+// ==== CPU DISPATCH ====
+// The hot kernels below are compiled once per instruction set tier and bound through
+// str_boundKernels on first use. Every kernel works on an explicit byte length so the vector
+// loads never run past the terminating NUL.
+
+typedef size_t (*StrAsciiScanFn)(const char* str, size_t len);
+
+typedef struct {
+    size_t (*asciiPrefix)(const char* str, size_t len);       // Bytes before the first non-ASCII byte
+    size_t (*validPrefix)(const char* str, size_t len);       // Bytes before the first malformed sequence
+    int (*length)(const char* str, size_t len);               // Code points, or -1 if malformed
+    const char* (*find)(const char* str, size_t len, const char* substr, size_t substrLen);
+    void (*mapAsciiCase)(char* str, size_t len, bool upper);  // Maps A-Z / a-z in place
+    bool (*equalsFold)(const char* a, const char* b, size_t len);  // Equal ignoring A-Z / a-z case
+    const char* (*findFold)(const char* str, size_t len, const char* substr, size_t substrLen);  // find ignoring A-Z / a-z case
+    size_t (*skipWhitespace)(const char* str, size_t len);    // Bytes of leading whitespace
+    // ASCII transcoding fast paths; each converts up to the first non-ASCII unit and returns the count
+    size_t (*widenAscii16)(const char* src, size_t len, uint16_t* dst, bool swap);
+    size_t (*widenAscii32)(const char* src, size_t len, uint32_t* dst);
+    size_t (*narrowAscii16)(const uint16_t* src, size_t len, char* dst, bool swap);
+    size_t (*narrowAscii32)(const uint32_t* src, size_t len, char* dst);
+    size_t (*countCrLf)(const char* str, size_t len);          // CR LF pairs, for grapheme counting
+} StrKernels;
+
+static const char* const str_isaNames[] = { "scalar", "sse42", "avx2", "avx512" };
+
+static bool str_isAsciiWhitespace(unsigned char byte) {
+    return byte == 0x20 || (byte >= 0x09 && byte <= 0x0D);
 }
 
-// Finds the first occurrence of a substring in a string
-const char* str_find(const char* str, const char* substr, int start) {
-    if (!str || !substr) {
-        str_last_error = STR_ERROR_NULL_INPUT;
-        return NULL;
-    }
-    if (start < 0) {
-        str_last_error = STR_ERROR_INVALID_INDEX;
-        return NULL;
-    }
+// Decodes the well-formed sequence at str into codePoint (which may be NULL); returns its length,
+// or 0 if it is malformed
+static int str_decodeSequence(const unsigned char* str, size_t avail, uint32_t* codePoint) {
+    uint32_t decoded;
+    int seqLen = str_utf8Decode(str, avail, codePoint ? codePoint : &decoded);
+    return seqLen > 0 ? seqLen : 0;
+}
 
-    int i = 0;
-    while (*str && i < start) {
-        str_getUTF8CodePoint(&str);
-        i++;
+// Validates str using the given ASCII skipper; returns the valid prefix and counts its code points
+static inline size_t str_scanUTF8(const char* str, size_t len, StrAsciiScanFn asciiPrefix, size_t* count) {
+    const unsigned char* bytes = (const unsigned char*)str;
+    size_t i = 0, n = 0;
+
+    while (i < len) {
+        size_t ascii = asciiPrefix(str + i, len - i);
+        i += ascii;
+        n += ascii;
+
+        // Stay scalar through runs of multi-byte text instead of re-entering the vector loop per character
+        while (i < len && bytes[i] >= 0x80) {
+            int seqLen = str_decodeSequence(bytes + i, len - i, NULL);
+            if (!seqLen) {
+                *count = n;
+                return i;
+            }
+            i += seqLen;
+            n++;
+        }
     }
 
-    return str_findHelper(str, substr);
+    *count = n;
+    return i;
 }
 
-// Helper function to find the substring in the string
-const char* str_findHelper(const char* str, const char* substr) {
-    if (!str || !substr) {
-        str_last_error = STR_ERROR_NULL_INPUT;
-        return NULL;
-    }
+// Skips leading whitespace using the given ASCII whitespace skipper
+static inline size_t str_skipWhitespaceWith(const char* str, size_t len, StrAsciiScanFn asciiSkip) {
+    const unsigned char* bytes = (const unsigned char*)str;
+    size_t i = 0;
 
-    while (*str) {
-        const char* tempStr = str;
-        const char* tempSubstr = substr;
-        int matched = 1;
-        
-        while (*tempSubstr && *tempStr) {
-            int codePoint1 = str_getUTF8CodePoint(&tempStr);
-            int codePoint2 = str_getUTF8CodePoint(&tempSubstr);
-            if (codePoint1 != codePoint2) {
-                matched = 0;
-                break;
-            }
-        }
+    while (i < len) {
+        i += asciiSkip(str + i, len - i);
+        if (i >= len || bytes[i] < 0x80) break;
 
-        if (matched && *tempSubstr == '\0') return str;
-        
-        str_getUTF8CodePoint(&str);
+        uint32_t codePoint;
+        int seqLen = str_decodeSequence(bytes + i, len - i, &codePoint);
+        if (!seqLen || !str_isUnicodeWhitespace((int)codePoint)) break;
+        i += seqLen;
     }
-    str_last_error = STR_SUCCESS;
-    return NULL;
+    return i;
 }
 
-// Copies characters from src to dest until the delimiter is found
-StrError str_copyUntil(const char* src, const char* delimiter, char* dest) {
-    if (!src || !delimiter || !dest) return (str_last_error = STR_ERROR_NULL_INPUT);
+// ---- Scalar kernels ----
 
-    const char* pos = str_find(src, delimiter, 0);
-    while (*src && src != pos) {
-        const char* srcStart = src;
-        str_getUTF8CodePoint(&src);
-        int len = src - srcStart;
-        strncpy(dest, srcStart, len);
-        dest += len;
-    }
-    
-    *dest = '\0';
-    return (str_last_error = STR_SUCCESS);
+static size_t str_asciiPrefix_scalar(const char* str, size_t len) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, str + i, sizeof(word));
+        if (word & 0x8080808080808080ULL) break;
+    }
+    while (i < len && (unsigned char)str[i] < 0x80) i++;
+    return i;
 }
 
-// Checks if a Unicode code point is a whitespace character
-int str_isUnicodeWhitespace(int codePoint) {
-    int size = sizeof(unicodeWhitespace) / sizeof(unicodeWhitespace[0]);
-    for (int i = 0; i < size; i++) {
-        if (unicodeWhitespace[i] == codePoint) return 1;
-    }
-    return 0;
+static size_t str_asciiWhitespace_scalar(const char* str, size_t len) {
+    size_t i = 0;
+    while (i < len && str_isAsciiWhitespace((unsigned char)str[i])) i++;
+    return i;
 }
 
-// Checks if a character is a whitespace character
-int str_isWhitespace(const char* str) {
-    if (!str) {
-        str_last_error = STR_ERROR_NULL_INPUT;
-        return 0;
+static const char* str_find_scalar(const char* str, size_t len, const char* substr, size_t substrLen) {
+    if (substrLen == 0) return str;
+    if (substrLen > len) return NULL;
+
+    const char* end = str + len - substrLen + 1;
+    const char* pos = str;
+    while (pos < end) {
+        pos = memchr(pos, substr[0], end - pos);
+        if (!pos) return NULL;
+        if (memcmp(pos + 1, substr + 1, substrLen - 1) == 0) return pos;
+        pos++;
     }
+    return NULL;
+}
 
-    int codePoint = str_getUTF8CodePoint(&str);
-    return (codePoint == 0x20 || codePoint == 0x09 || codePoint == 0x0A || 
-            codePoint == 0x0D || str_isUnicodeWhitespace(codePoint));
+static void str_mapAsciiCase_scalar(char* str, size_t len, bool upper) {
+    unsigned char first = upper ? 'a' : 'A';
+    for (size_t i = 0; i < len; i++) {
+        if ((unsigned char)(str[i] - first) < 26) str[i] ^= 0x20;
+    }
 }
 
-// Validates if a string is valid UTF-8
-bool str_isValidUTF8(const char* str) {
-    if (!str) return false;
+static inline unsigned char str_foldAscii(unsigned char byte) {
+    return (unsigned char)(byte - 'A') < 26 ? byte | 0x20 : byte;
+}
 
-    while (*str) {
-        int seqLen = str_getUTF8CodePoint(&str);
-        if (seqLen == -1 || (seqLen == 4 && str_getCodePointFromBytes(str, seqLen) > 0x10FFFF)) {
-            return false;
-        }
+static bool str_equalsFold_scalar(const char* a, const char* b, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (str_foldAscii((unsigned char)a[i]) != str_foldAscii((unsigned char)b[i])) return false;
     }
     return true;
 }
 
-// Gets the length of the UTF-8 sequence starting with a byte
-int str_getUTF8SequenceLength(unsigned char byte) {
-    if (byte <= 0x7F) return 1;
-    else if ((byte & 0xE0) == 0xC0) return 2;
-    else if ((byte & 0xF0) == 0xE0) return 3;
-    else if ((byte & 0xF8) == 0xF0) return 4;
-    return -1;
+// Horspool scan; the skip table holds both cases of every letter
+static const char* str_findFold_scalar(const char* str, size_t len, const char* substr, size_t substrLen) {
+    if (substrLen == 0) return str;
+    if (substrLen > len) return NULL;
+
+    size_t skip[256];
+    for (int i = 0; i < 256; i++) skip[i] = substrLen;
+    for (size_t i = 0; i + 1 < substrLen; i++) {
+        unsigned char folded = str_foldAscii((unsigned char)substr[i]);
+        skip[folded] = substrLen - 1 - i;
+        if (folded >= 'a' && folded <= 'z') skip[folded ^ 0x20] = substrLen - 1 - i;
+    }
+
+    unsigned char last = str_foldAscii((unsigned char)substr[substrLen - 1]);
+    for (size_t pos = 0; pos + substrLen <= len; ) {
+        unsigned char byte = (unsigned char)str[pos + substrLen - 1];
+        if (str_foldAscii(byte) == last && str_equalsFold_scalar(str + pos, substr, substrLen - 1)) return str + pos;
+        pos += skip[byte];
+    }
+    return NULL;
 }
 
-// Returns the code point from a sequence of UTF-8 bytes
-int str_getCodePointFromBytes(const char* str, int seqLen) {
-    if (!str || seqLen < 1 || seqLen > 4) return -1;
+// OR-ing a text byte with the returned mask folds it to the folded byte when it is the same letter
+static inline char str_foldMask(unsigned char byte) {
+    return (unsigned char)((byte | 0x20) - 'a') < 26 ? 0x20 : 0;
+}
 
-    int codePoint = 0;
-    if (seqLen == 1) return *str;
-    if (seqLen == 2) {
-        codePoint = (*str & 0x1F) << 6;
-        codePoint |= (*(str + 1) & 0x3F);
-    } else if (seqLen == 3) {
-        codePoint = (*str & 0x0F) << 12;
-        codePoint |= (*(str + 1) & 0x3F) << 6;
-        codePoint |= (*(str + 2) & 0x3F);
-    } else if (seqLen == 4) {
-        codePoint = (*str & 0x07) << 18;
-        codePoint |= (*(str + 1) & 0x3F) << 12;
-        codePoint |= (*(str + 2) & 0x3F) << 6;
-        codePoint |= (*(str + 3) & 0x3F);
+static uint16_t str_swap16(uint16_t unit) {
+    return (uint16_t)((unit << 8) | (unit >> 8));
+}
+
+static size_t str_widenAscii16_scalar(const char* src, size_t len, uint16_t* dst, bool swap) {
+    size_t i = 0;
+    for (; i < len && (unsigned char)src[i] < 0x80; i++) {
+        dst[i] = swap ? str_swap16((unsigned char)src[i]) : (unsigned char)src[i];
     }
-    return codePoint;
+    return i;
 }
 
-// Gets the Unicode code point from the start of the string and advances the pointer
-int str_getUTF8CodePoint(const char** str) {
-    if (!str || !*str) return -1;
+static size_t str_widenAscii32_scalar(const char* src, size_t len, uint32_t* dst) {
+    size_t i = 0;
+    for (; i < len && (unsigned char)src[i] < 0x80; i++) dst[i] = (unsigned char)src[i];
+    return i;
+}
 
-    unsigned char byte = (unsigned char)**str;
-    int seqLen = str_getUTF8SequenceLength(byte);
-    if (seqLen == -1) return -1;
+static size_t str_narrowAscii16_scalar(const uint16_t* src, size_t len, char* dst, bool swap) {
+    size_t i = 0;
+    for (; i < len; i++) {
+        uint16_t unit = swap ? str_swap16(src[i]) : src[i];
+        if (unit >= 0x80) break;
+        dst[i] = (char)unit;
+    }
+    return i;
+}
 
-    int codePoint = str_getCodePointFromBytes(*str, seqLen);
-    *str += seqLen;
-    return codePoint;
+static size_t str_narrowAscii32_scalar(const uint32_t* src, size_t len, char* dst) {
+    size_t i = 0;
+    for (; i < len && src[i] < 0x80; i++) dst[i] = (char)src[i];
+    return i;
 }
 
-// Returns the length of the string in code points
-int str_length(const char* str) {
-    if (!str) return -1;
+static size_t str_countCrLf_scalar(const char* str, size_t len) {
+    // Compare eight positions at a time; the high bit is set in each byte equal to the target
+    const uint64_t ones = 0x0101010101010101ULL, low = 0x7F7F7F7F7F7F7F7FULL;
+    size_t pairs = 0, i = 0;
+    for (; i + 9 <= len; i += 8) {
+        uint64_t here, next;
+        memcpy(&here, str + i, sizeof(here));
+        memcpy(&next, str + i + 1, sizeof(next));
+        uint64_t cr = here ^ (ones * '\r'), lf = next ^ (ones * '\n');
+        cr = ~(((cr & low) + low) | cr) & ~low;
+        lf = ~(((lf & low) + low) | lf) & ~low;
+        if (cr & lf) pairs += (((cr & lf) >> 7) * ones) >> 56;
+    }
+    for (; i + 1 < len; i++) {
+        if (str[i] == '\r' && str[i + 1] == '\n') pairs++;
+    }
+    return pairs;
+}
 
-    int length = 0;
-    while (*str) {
-        int seqLen = str_getUTF8CodePoint(&str);
-        if (seqLen == -1) return -1;
-        length++;
+// ---- SSE4.2 / AVX2 / AVX-512 kernels ----
+
+#ifdef STR_X86_DISPATCH
+
+static STR_TARGET_SSE42 size_t str_asciiPrefix_sse42(const char* str, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        unsigned mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(str + i)));
+        if (mask) return i + __builtin_ctz(mask);
     }
-    return length;
+    return i + str_asciiPrefix_scalar(str + i, len - i);
 }
 
-// Returns the character at a specific index in a string
-char* str_charAt(const char* str, int index) {
-    if (!str || index < 0) return NULL;
+static STR_TARGET_SSE42 size_t str_asciiWhitespace_sse42(const char* str, size_t len) {
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i tab = _mm_set1_epi8(0x09);
+    const __m128i four = _mm_set1_epi8(4);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i control = _mm_sub_epi8(block, tab);
+        __m128i isSpace = _mm_or_si128(_mm_cmpeq_epi8(block, space),
+                                       _mm_cmpeq_epi8(_mm_min_epu8(control, four), control));
+        unsigned mask = ~_mm_movemask_epi8(isSpace) & 0xFFFF;
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + str_asciiWhitespace_scalar(str + i, len - i);
+}
 
-    int i = 0;
-    const char* start;
-    while (*str) {
-        start = str;
-        str_getUTF8CodePoint(&str);
-        if (i == index) {
-            int len = str - start;
-            char* result = malloc(len + 1);
-            if (!result) return NULL;
-            strncpy(result, start, len);
-            result[len] = '\0';
-            return result;
+static STR_TARGET_SSE42 const char* str_find_sse42(const char* str, size_t len, const char* substr, size_t substrLen) {
+    if (substrLen < 2 || substrLen > len) return str_find_scalar(str, len, substr, substrLen);
+
+    // Compare the first and last needle bytes across 16 candidate positions at once
+    const __m128i first = _mm_set1_epi8(substr[0]);
+    const __m128i last = _mm_set1_epi8(substr[substrLen - 1]);
+    size_t i = 0;
+    for (; i + substrLen - 1 + 16 <= len; i += 16) {
+        __m128i blockFirst = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i blockLast = _mm_loadu_si128((const __m128i*)(str + i + substrLen - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first),
+                                                        _mm_cmpeq_epi8(blockLast, last)));
+        while (mask) {
+            unsigned bit = __builtin_ctz(mask);
+            if (memcmp(str + i + bit + 1, substr + 1, substrLen - 2) == 0) return str + i + bit;
+            mask &= mask - 1;
         }
-        i++;
     }
-    return NULL;
+    return str_find_scalar(str + i, len - i, substr, substrLen);
 }
 
-// Returns the ASCII value of the character at a specific index in a string
-int str_charCodeAt(const char* str, int index) {
-    if (!str) {
-        str_last_error = STR_ERROR_NULL_INPUT;
-        return -1;
+static STR_TARGET_SSE42 void str_mapAsciiCase_sse42(char* str, size_t len, bool upper) {
+    // Bias the letter range down to -128..-103 so a signed compare selects it
+    const __m128i bias = _mm_set1_epi8((char)(0x80 - (upper ? 'a' : 'A')));
+    const __m128i limit = _mm_set1_epi8((char)(0x80 + 26));
+    const __m128i flip = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i isLetter = _mm_cmplt_epi8(_mm_add_epi8(block, bias), limit);
+        _mm_storeu_si128((__m128i*)(str + i), _mm_xor_si128(block, _mm_and_si128(isLetter, flip)));
     }
-    if (index < 0) {
-        str_last_error = STR_ERROR_INVALID_INDEX;
-        return -1;
+    str_mapAsciiCase_scalar(str + i, len - i, upper);
+}
+
+static STR_TARGET_SSE42 bool str_equalsFold_sse42(const char* a, const char* b, size_t len) {
+    // Lower-case both sides with the biased compare from mapAsciiCase, then compare
+    const __m128i bias = _mm_set1_epi8((char)(0x80 - 'A'));
+    const __m128i limit = _mm_set1_epi8((char)(0x80 + 26));
+    const __m128i flip = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+        x = _mm_or_si128(x, _mm_and_si128(_mm_cmplt_epi8(_mm_add_epi8(x, bias), limit), flip));
+        y = _mm_or_si128(y, _mm_and_si128(_mm_cmplt_epi8(_mm_add_epi8(y, bias), limit), flip));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) return false;
     }
+    return str_equalsFold_scalar(a + i, b + i, len - i);
+}
 
-    int i = 0;
-    while (*str) {
-        int codePoint = str_getUTF8CodePoint(&str);
-        if (i == index) {
-            str_last_error = STR_SUCCESS;
-            return codePoint;
+static STR_TARGET_SSE42 const char* str_findFold_sse42(const char* str, size_t len, const char* substr, size_t substrLen) {
+    if (substrLen < 2 || substrLen > len) return str_findFold_scalar(str, len, substr, substrLen);
+
+    // Like find, with each block OR-ed into lower case where the needle byte is a letter
+    const char firstCase = str_foldMask(substr[0]), lastCase = str_foldMask(substr[substrLen - 1]);
+    const __m128i first = _mm_set1_epi8((char)(substr[0] | firstCase));
+    const __m128i last = _mm_set1_epi8((char)(substr[substrLen - 1] | lastCase));
+    const __m128i firstMask = _mm_set1_epi8(firstCase), lastMask = _mm_set1_epi8(lastCase);
+    size_t i = 0;
+    for (; i + substrLen - 1 + 16 <= len; i += 16) {
+        __m128i blockFirst = _mm_or_si128(_mm_loadu_si128((const __m128i*)(str + i)), firstMask);
+        __m128i blockLast = _mm_or_si128(_mm_loadu_si128((const __m128i*)(str + i + substrLen - 1)), lastMask);
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first),
+                                                        _mm_cmpeq_epi8(blockLast, last)));
+        while (mask) {
+            unsigned bit = __builtin_ctz(mask);
+            if (str_equalsFold_sse42(str + i + bit + 1, substr + 1, substrLen - 2)) return str + i + bit;
+            mask &= mask - 1;
         }
-        i++;
     }
-    str_last_error = STR_ERROR_INVALID_INDEX;
-    return -1;
+    return str_findFold_scalar(str + i, len - i, substr, substrLen);
 }
 
-// Returns the index of the first occurrence of a substring in a string
-int str_indexOf(const char* str, const char* substr) {
-    if (!str || !substr) {
-        str_last_error = STR_ERROR_NULL_INPUT;
-        return -1;
+static STR_TARGET_SSE42 size_t str_widenAscii16_sse42(const char* src, size_t len, uint16_t* dst, bool swap) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(src + i));
+        if (_mm_movemask_epi8(block)) break;
+        // Interleaving with zero bytes on the other side yields big-endian units
+        __m128i lo = swap ? _mm_unpacklo_epi8(zero, block) : _mm_unpacklo_epi8(block, zero);
+        __m128i hi = swap ? _mm_unpackhi_epi8(zero, block) : _mm_unpackhi_epi8(block, zero);
+        _mm_storeu_si128((__m128i*)(dst + i), lo);
+        _mm_storeu_si128((__m128i*)(dst + i + 8), hi);
     }
+    return i + str_widenAscii16_scalar(src + i, len - i, dst + i, swap);
+}
 
-    int i = 0;
-    while (*str) {
-        if (str_findHelper(str, substr)) {
-            str_last_error = STR_SUCCESS;
-            return i;
+static STR_TARGET_SSE42 size_t str_widenAscii32_sse42(const char* src, size_t len, uint32_t* dst) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(src + i));
+        if (_mm_movemask_epi8(block)) break;
+        for (int k = 0; k < 4; k++) {
+            _mm_storeu_si128((__m128i*)(dst + i + 4 * k), _mm_cvtepu8_epi32(block));
+            block = _mm_srli_si128(block, 4);
         }
-        str_getUTF8CodePoint(&str);
-        i++;
     }
+    return i + str_widenAscii32_scalar(src + i, len - i, dst + i);
+}
 
-    str_last_error = STR_SUCCESS;
-    return -1;
+static STR_TARGET_SSE42 size_t str_narrowAscii16_sse42(const uint16_t* src, size_t len, char* dst, bool swap) {
+    const __m128i nonAscii = _mm_set1_epi16((short)0xFF80);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 8));
+        if (swap) {
+            a = _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+            b = _mm_or_si128(_mm_slli_epi16(b, 8), _mm_srli_epi16(b, 8));
+        }
+        if (!_mm_testz_si128(_mm_or_si128(a, b), nonAscii)) break;
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(a, b));
+    }
+    return i + str_narrowAscii16_scalar(src + i, len - i, dst + i, swap);
 }
 
-// Returns the index of the last occurrence of a substring in a string
-int str_lastIndexOf(const char* str, const char* substr) {
-    if (!str || !substr) {
-        str_last_error = STR_ERROR_NULL_INPUT;
-        return -1;
+static STR_TARGET_SSE42 size_t str_narrowAscii32_sse42(const uint32_t* src, size_t len, char* dst) {
+    const __m128i nonAscii = _mm_set1_epi32((int)0xFFFFFF80);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 4));
+        __m128i c = _mm_loadu_si128((const __m128i*)(src + i + 8));
+        __m128i d = _mm_loadu_si128((const __m128i*)(src + i + 12));
+        __m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+        if (!_mm_testz_si128(any, nonAscii)) break;
+        __m128i packed = _mm_packus_epi16(_mm_packus_epi32(a, b), _mm_packus_epi32(c, d));
+        _mm_storeu_si128((__m128i*)(dst + i), packed);
     }
+    return i + str_narrowAscii32_scalar(src + i, len - i, dst + i);
+}
 
-    int lastIndex = -1;
-    int index = 0;
-    while (*str) {
-        const char* pos = str_find(str, substr, index);
-        if (pos) {
-            lastIndex = pos - str;
-            index = lastIndex + 1;
-        } else {
-            break;
-        }
+static STR_TARGET_SSE42 size_t str_countCrLf_sse42(const char* str, size_t len) {
+    const __m128i cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n');
+    size_t pairs = 0, i = 0;
+    for (; i + 17 <= len; i += 16) {
+        __m128i here = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i next = _mm_loadu_si128((const __m128i*)(str + i + 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(here, cr), _mm_cmpeq_epi8(next, lf)));
+        if (mask) pairs += __builtin_popcount(mask);
     }
-    return lastIndex;
+    return pairs + str_countCrLf_scalar(str + i, len - i);
 }
 
-// Joins two strings together
-StrError str_concat(const char* str1, const char* str2, char* result) {
-    if (!str1 || !str2 || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+static STR_TARGET_AVX2 size_t str_asciiPrefix_avx2(const char* str, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        unsigned mask = _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(str + i)));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + str_asciiPrefix_sse42(str + i, len - i);
+}
 
-    while (*str1) {
-        int seqLen = str_getUTF8SequenceLength((unsigned char)*str1);
-        strncpy(result, str1, seqLen);
-        result += seqLen;
-        str1 += seqLen;
+static STR_TARGET_AVX2 size_t str_asciiWhitespace_avx2(const char* str, size_t len) {
+    const __m256i space = _mm256_set1_epi8(0x20);
+    const __m256i tab = _mm256_set1_epi8(0x09);
+    const __m256i four = _mm256_set1_epi8(4);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(str + i));
+        __m256i control = _mm256_sub_epi8(block, tab);
+        __m256i isSpace = _mm256_or_si256(_mm256_cmpeq_epi8(block, space),
+                                          _mm256_cmpeq_epi8(_mm256_min_epu8(control, four), control));
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(isSpace);
+        if (mask) return i + __builtin_ctz(mask);
     }
+    return i + str_asciiWhitespace_sse42(str + i, len - i);
+}
 
-    while (*str2) {
-        int seqLen = str_getUTF8SequenceLength((unsigned char)*str2);
-        strncpy(result, str2, seqLen);
-        result += seqLen;
-        str2 += seqLen;
+static STR_TARGET_AVX2 const char* str_find_avx2(const char* str, size_t len, const char* substr, size_t substrLen) {
+    if (substrLen < 2 || substrLen > len) return str_find_scalar(str, len, substr, substrLen);
+
+    const __m256i first = _mm256_set1_epi8(substr[0]);
+    const __m256i last = _mm256_set1_epi8(substr[substrLen - 1]);
+    size_t i = 0;
+    for (; i + substrLen - 1 + 32 <= len; i += 32) {
+        __m256i blockFirst = _mm256_loadu_si256((const __m256i*)(str + i));
+        __m256i blockLast = _mm256_loadu_si256((const __m256i*)(str + i + substrLen - 1));
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first),
+                                                              _mm256_cmpeq_epi8(blockLast, last)));
+        while (mask) {
+            unsigned bit = __builtin_ctz(mask);
+            if (memcmp(str + i + bit + 1, substr + 1, substrLen - 2) == 0) return str + i + bit;
+            mask &= mask - 1;
+        }
     }
+    return str_find_sse42(str + i, len - i, substr, substrLen);
+}
 
-    *result = '\0';
-    return (str_last_error = STR_SUCCESS);
+static STR_TARGET_AVX2 void str_mapAsciiCase_avx2(char* str, size_t len, bool upper) {
+    const __m256i bias = _mm256_set1_epi8((char)(0x80 - (upper ? 'a' : 'A')));
+    const __m256i limit = _mm256_set1_epi8((char)(0x80 + 26));
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(str + i));
+        __m256i isLetter = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(block, bias));
+        _mm256_storeu_si256((__m256i*)(str + i), _mm256_xor_si256(block, _mm256_and_si256(isLetter, flip)));
+    }
+    str_mapAsciiCase_sse42(str + i, len - i, upper);
 }
 
-// Converts the entire string to lowercase
-StrError str_toLowerCase(char* str) {
-    if (!str) return (str_last_error = STR_ERROR_NULL_INPUT);
+static STR_TARGET_AVX2 bool str_equalsFold_avx2(const char* a, const char* b, size_t len) {
+    const __m256i bias = _mm256_set1_epi8((char)(0x80 - 'A'));
+    const __m256i limit = _mm256_set1_epi8((char)(0x80 + 26));
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        x = _mm256_or_si256(x, _mm256_and_si256(_mm256_cmpgt_epi8(limit, _mm256_add_epi8(x, bias)), flip));
+        y = _mm256_or_si256(y, _mm256_and_si256(_mm256_cmpgt_epi8(limit, _mm256_add_epi8(y, bias)), flip));
+        if ((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != 0xFFFFFFFFu) return false;
+    }
+    return str_equalsFold_sse42(a + i, b + i, len - i);
+}
 
-    const char* src = str;
-    while (*str) {
-        int codePoint = str_getUTF8CodePoint(&src);
-        if (codePoint >= 'A' && codePoint <= 'Z') {
-            *str = *str + 32;  // Convert ASCII uppercase to lowercase
+static STR_TARGET_AVX2 const char* str_findFold_avx2(const char* str, size_t len, const char* substr, size_t substrLen) {
+    if (substrLen < 2 || substrLen > len) return str_findFold_scalar(str, len, substr, substrLen);
+
+    const char firstCase = str_foldMask(substr[0]), lastCase = str_foldMask(substr[substrLen - 1]);
+    const __m256i first = _mm256_set1_epi8((char)(substr[0] | firstCase));
+    const __m256i last = _mm256_set1_epi8((char)(substr[substrLen - 1] | lastCase));
+    const __m256i firstMask = _mm256_set1_epi8(firstCase), lastMask = _mm256_set1_epi8(lastCase);
+    size_t i = 0;
+    for (; i + substrLen - 1 + 32 <= len; i += 32) {
+        __m256i blockFirst = _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(str + i)), firstMask);
+        __m256i blockLast = _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(str + i + substrLen - 1)), lastMask);
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first),
+                                                              _mm256_cmpeq_epi8(blockLast, last)));
+        while (mask) {
+            unsigned bit = __builtin_ctz(mask);
+            if (str_equalsFold_avx2(str + i + bit + 1, substr + 1, substrLen - 2)) return str + i + bit;
+            mask &= mask - 1;
         }
-        str++;
     }
+    return str_findFold_sse42(str + i, len - i, substr, substrLen);
+}
 
-    return (str_last_error = STR_SUCCESS);
+static STR_TARGET_AVX2 size_t str_widenAscii16_avx2(const char* src, size_t len, uint16_t* dst, bool swap) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(src + i));
+        if (_mm256_movemask_epi8(block)) break;
+        __m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(block));
+        __m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(block, 1));
+        if (swap) {
+            lo = _mm256_slli_epi16(lo, 8);
+            hi = _mm256_slli_epi16(hi, 8);
+        }
+        _mm256_storeu_si256((__m256i*)(dst + i), lo);
+        _mm256_storeu_si256((__m256i*)(dst + i + 16), hi);
+    }
+    return i + str_widenAscii16_sse42(src + i, len - i, dst + i, swap);
 }
 
-// Converts the entire string to uppercase
-StrError str_toUpperCase(char* str) {
-    if (!str) return (str_last_error = STR_ERROR_NULL_INPUT);
+static STR_TARGET_AVX2 size_t str_widenAscii32_avx2(const char* src, size_t len, uint32_t* dst) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(src + i));
+        if (_mm256_movemask_epi8(block)) break;
+        __m128i lo = _mm256_castsi256_si128(block);
+        __m128i hi = _mm256_extracti128_si256(block, 1);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_cvtepu8_epi32(lo));
+        _mm256_storeu_si256((__m256i*)(dst + i + 8), _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+        _mm256_storeu_si256((__m256i*)(dst + i + 16), _mm256_cvtepu8_epi32(hi));
+        _mm256_storeu_si256((__m256i*)(dst + i + 24), _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+    }
+    return i + str_widenAscii32_sse42(src + i, len - i, dst + i);
+}
 
-    const char* src = str;
-    while (*str) {
-        int codePoint = str_getUTF8CodePoint(&src);
-        if (codePoint >= 'a' && codePoint <= 'z') {
-            *str = *str - 32;  // Convert ASCII lowercase to uppercase
+static STR_TARGET_AVX2 size_t str_narrowAscii16_avx2(const uint16_t* src, size_t len, char* dst, bool swap) {
+    const __m256i nonAscii = _mm256_set1_epi16((short)0xFF80);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 16));
+        if (swap) {
+            a = _mm256_or_si256(_mm256_slli_epi16(a, 8), _mm256_srli_epi16(a, 8));
+            b = _mm256_or_si256(_mm256_slli_epi16(b, 8), _mm256_srli_epi16(b, 8));
         }
-        str++;
+        if (!_mm256_testz_si256(_mm256_or_si256(a, b), nonAscii)) break;
+        // packus works per 128-bit lane, so restore the quadword order afterwards
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i*)(dst + i), packed);
     }
-
-    return (str_last_error = STR_SUCCESS);
+    return i + str_narrowAscii16_sse42(src + i, len - i, dst + i, swap);
 }
 
-// Removes leading whitespace from a string
-StrError str_trimStart(char* str) {
-    if (!str) return (str_last_error = STR_ERROR_NULL_INPUT);
+static STR_TARGET_AVX2 size_t str_narrowAscii32_avx2(const uint32_t* src, size_t len, char* dst) {
+    const __m256i nonAscii = _mm256_set1_epi32((int)0xFFFFFF80);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 8));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(src + i + 16));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(src + i + 24));
+        __m256i any = _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d));
+        if (!_mm256_testz_si256(any, nonAscii)) break;
+        __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(a, b), _mm256_packus_epi32(c, d));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_permutevar8x32_epi32(packed, order));
+    }
+    return i + str_narrowAscii32_sse42(src + i, len - i, dst + i);
+}
 
-    const char* start = str;
-    while (*start && str_isWhitespace(start)) {
-        str_getUTF8CodePoint(&start);
+static STR_TARGET_AVX2 size_t str_countCrLf_avx2(const char* str, size_t len) {
+    const __m256i cr = _mm256_set1_epi8('\r'), lf = _mm256_set1_epi8('\n');
+    size_t pairs = 0, i = 0;
+    for (; i + 33 <= len; i += 32) {
+        __m256i here = _mm256_loadu_si256((const __m256i*)(str + i));
+        __m256i next = _mm256_loadu_si256((const __m256i*)(str + i + 1));
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(here, cr), _mm256_cmpeq_epi8(next, lf)));
+        if (mask) pairs += __builtin_popcount(mask);
     }
-    memmove(str, start, strlen(start) + 1);
-    return (str_last_error = STR_SUCCESS);
+    return pairs + str_countCrLf_sse42(str + i, len - i);
 }
 
-// Removes trailing whitespace from a string
-StrError str_trimEnd(char* str) {
-    if (!str || !*str) return (str_last_error = STR_ERROR_NULL_INPUT);
+static STR_TARGET_AVX512 size_t str_asciiPrefix_avx512(const char* str, size_t len) {
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __mmask64 mask = _mm512_movepi8_mask(_mm512_loadu_si512((const void*)(str + i)));
+        if (mask) return i + __builtin_ctzll(mask);
+    }
+    return i + str_asciiPrefix_avx2(str + i, len - i);
+}
 
-    char* end = str + strlen(str);
-    char* last = end - 1;
+static STR_TARGET_AVX512 size_t str_asciiWhitespace_avx512(const char* str, size_t len) {
+    const __m512i space = _mm512_set1_epi8(0x20);
+    const __m512i tab = _mm512_set1_epi8(0x09);
+    const __m512i four = _mm512_set1_epi8(4);
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m512i block = _mm512_loadu_si512((const void*)(str + i));
+        __mmask64 isSpace = _mm512_cmpeq_epi8_mask(block, space) |
+                            _mm512_cmple_epu8_mask(_mm512_sub_epi8(block, tab), four);
+        if (~isSpace) return i + __builtin_ctzll(~isSpace);
+    }
+    return i + str_asciiWhitespace_avx2(str + i, len - i);
+}
 
-    while (last >= str) {
-        while (last > str && (*last & 0xC0) == 0x80) {
-            last--;
+static STR_TARGET_AVX512 const char* str_find_avx512(const char* str, size_t len, const char* substr, size_t substrLen) {
+    if (substrLen < 2 || substrLen > len) return str_find_scalar(str, len, substr, substrLen);
+
+    const __m512i first = _mm512_set1_epi8(substr[0]);
+    const __m512i last = _mm512_set1_epi8(substr[substrLen - 1]);
+    size_t i = 0;
+    for (; i + substrLen - 1 + 64 <= len; i += 64) {
+        __m512i blockFirst = _mm512_loadu_si512((const void*)(str + i));
+        __m512i blockLast = _mm512_loadu_si512((const void*)(str + i + substrLen - 1));
+        __mmask64 mask = _mm512_cmpeq_epi8_mask(blockFirst, first) & _mm512_cmpeq_epi8_mask(blockLast, last);
+        while (mask) {
+            unsigned bit = __builtin_ctzll(mask);
+            if (memcmp(str + i + bit + 1, substr + 1, substrLen - 2) == 0) return str + i + bit;
+            mask &= mask - 1;
         }
-        
-        if (!str_isWhitespace(last)) break;
-        
-        end = last;
-        last = end - 1;
     }
-
-    *end = '\0';
-    return (str_last_error = STR_SUCCESS);
+    return str_find_avx2(str + i, len - i, substr, substrLen);
 }
 
-// Trims whitespace from both ends of the string
-StrError str_trim(char* str) {
-    str_trimStart(str);
-    str_trimEnd(str);
-    return (str_last_error = STR_SUCCESS);
+static STR_TARGET_AVX512 void str_mapAsciiCase_avx512(char* str, size_t len, bool upper) {
+    const __m512i first = _mm512_set1_epi8(upper ? 'a' : 'A');
+    const __m512i letters = _mm512_set1_epi8(25);
+    const __m512i flip = _mm512_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m512i block = _mm512_loadu_si512((const void*)(str + i));
+        __mmask64 isLetter = _mm512_cmple_epu8_mask(_mm512_sub_epi8(block, first), letters);
+        _mm512_storeu_si512((void*)(str + i), _mm512_mask_blend_epi8(isLetter, block, _mm512_xor_si512(block, flip)));
+    }
+    str_mapAsciiCase_avx2(str + i, len - i, upper);
 }
 
-// Repeats a string a given number of times
-StrError str_repeat(const char* str, int count, char* result) {
-    if (!str || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
-    if (count < 0) return (str_last_error = STR_ERROR_INVALID_INDEX);
+static STR_TARGET_AVX512 bool str_equalsFold_avx512(const char* a, const char* b, size_t len) {
+    const __m512i first = _mm512_set1_epi8('A');
+    const __m512i letters = _mm512_set1_epi8(25);
+    const __m512i flip = _mm512_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m512i x = _mm512_loadu_si512((const void*)(a + i));
+        __m512i y = _mm512_loadu_si512((const void*)(b + i));
+        x = _mm512_mask_blend_epi8(_mm512_cmple_epu8_mask(_mm512_sub_epi8(x, first), letters), x, _mm512_or_si512(x, flip));
+        y = _mm512_mask_blend_epi8(_mm512_cmple_epu8_mask(_mm512_sub_epi8(y, first), letters), y, _mm512_or_si512(y, flip));
+        if (_mm512_cmpneq_epi8_mask(x, y)) return false;
+    }
+    return str_equalsFold_avx2(a + i, b + i, len - i);
+}
 
-    int strLen = str_length(str);
-    if (strLen == -1) return (str_last_error = STR_ERROR_INVALID_UTF8);
+static STR_TARGET_AVX512 const char* str_findFold_avx512(const char* str, size_t len, const char* substr, size_t substrLen) {
+    if (substrLen < 2 || substrLen > len) return str_findFold_scalar(str, len, substr, substrLen);
+
+    const char firstCase = str_foldMask(substr[0]), lastCase = str_foldMask(substr[substrLen - 1]);
+    const __m512i first = _mm512_set1_epi8((char)(substr[0] | firstCase));
+    const __m512i last = _mm512_set1_epi8((char)(substr[substrLen - 1] | lastCase));
+    const __m512i firstMask = _mm512_set1_epi8(firstCase), lastMask = _mm512_set1_epi8(lastCase);
+    size_t i = 0;
+    for (; i + substrLen - 1 + 64 <= len; i += 64) {
+        __m512i blockFirst = _mm512_or_si512(_mm512_loadu_si512((const void*)(str + i)), firstMask);
+        __m512i blockLast = _mm512_or_si512(_mm512_loadu_si512((const void*)(str + i + substrLen - 1)), lastMask);
+        __mmask64 mask = _mm512_cmpeq_epi8_mask(blockFirst, first) & _mm512_cmpeq_epi8_mask(blockLast, last);
+        while (mask) {
+            unsigned bit = __builtin_ctzll(mask);
+            if (str_equalsFold_avx512(str + i + bit + 1, substr + 1, substrLen - 2)) return str + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return str_findFold_avx2(str + i, len - i, substr, substrLen);
+}
 
-    for (int i = 0; i < count; i++) {
-        strncpy(result, str, strLen);
-        result += strLen;
+static STR_TARGET_AVX512 size_t str_widenAscii16_avx512(const char* src, size_t len, uint16_t* dst, bool swap) {
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m512i block = _mm512_loadu_si512((const void*)(src + i));
+        if (_mm512_movepi8_mask(block)) break;
+        __m512i lo = _mm512_cvtepu8_epi16(_mm512_castsi512_si256(block));
+        __m512i hi = _mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(block, 1));
+        if (swap) {
+            lo = _mm512_slli_epi16(lo, 8);
+            hi = _mm512_slli_epi16(hi, 8);
+        }
+        _mm512_storeu_si512((void*)(dst + i), lo);
+        _mm512_storeu_si512((void*)(dst + i + 32), hi);
     }
+    return i + str_widenAscii16_avx2(src + i, len - i, dst + i, swap);
+}
 
-    *result = '\0';
-    return (str_last_error = STR_SUCCESS);
+static STR_TARGET_AVX512 size_t str_widenAscii32_avx512(const char* src, size_t len, uint32_t* dst) {
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m512i block = _mm512_loadu_si512((const void*)(src + i));
+        if (_mm512_movepi8_mask(block)) break;
+        _mm512_storeu_si512((void*)(dst + i), _mm512_cvtepu8_epi32(_mm512_extracti32x4_epi32(block, 0)));
+        _mm512_storeu_si512((void*)(dst + i + 16), _mm512_cvtepu8_epi32(_mm512_extracti32x4_epi32(block, 1)));
+        _mm512_storeu_si512((void*)(dst + i + 32), _mm512_cvtepu8_epi32(_mm512_extracti32x4_epi32(block, 2)));
+        _mm512_storeu_si512((void*)(dst + i + 48), _mm512_cvtepu8_epi32(_mm512_extracti32x4_epi32(block, 3)));
+    }
+    return i + str_widenAscii32_avx2(src + i, len - i, dst + i);
 }
 
-// Check if a string starts with a given prefix
-int str_startsWith(const char* str, const char* prefix) {
-    if (!str || !prefix) {
-        str_last_error = STR_ERROR_NULL_INPUT;
-        return 0;
+static STR_TARGET_AVX512 size_t str_narrowAscii16_avx512(const uint16_t* src, size_t len, char* dst, bool swap) {
+    const __m512i nonAscii = _mm512_set1_epi16((short)0xFF80);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m512i units = _mm512_loadu_si512((const void*)(src + i));
+        if (swap) units = _mm512_or_si512(_mm512_slli_epi16(units, 8), _mm512_srli_epi16(units, 8));
+        if (_mm512_test_epi16_mask(units, nonAscii)) break;
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm512_cvtepi16_epi8(units));
     }
+    return i + str_narrowAscii16_avx2(src + i, len - i, dst + i, swap);
+}
 
-    while (*prefix) {
-        if (*str++ != *prefix++) return 0;
+static STR_TARGET_AVX512 size_t str_narrowAscii32_avx512(const uint32_t* src, size_t len, char* dst) {
+    const __m512i nonAscii = _mm512_set1_epi32((int)0xFFFFFF80);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m512i units = _mm512_loadu_si512((const void*)(src + i));
+        if (_mm512_test_epi32_mask(units, nonAscii)) break;
+        _mm_storeu_si128((__m128i*)(dst + i), _mm512_cvtepi32_epi8(units));
     }
+    return i + str_narrowAscii32_avx2(src + i, len - i, dst + i);
+}
 
-    return 1;
+static STR_TARGET_AVX512 size_t str_countCrLf_avx512(const char* str, size_t len) {
+    const __m512i cr = _mm512_set1_epi8('\r'), lf = _mm512_set1_epi8('\n');
+    size_t pairs = 0, i = 0;
+    for (; i + 65 <= len; i += 64) {
+        __m512i here = _mm512_loadu_si512((const void*)(str + i));
+        __m512i next = _mm512_loadu_si512((const void*)(str + i + 1));
+        __mmask64 mask = _mm512_cmpeq_epi8_mask(here, cr) & _mm512_cmpeq_epi8_mask(next, lf);
+        if (mask) pairs += __builtin_popcountll(mask);
+    }
+    return pairs + str_countCrLf_avx2(str + i, len - i);
 }
 
-// Check if a string ends with a given suffix
-int str_endsWith(const char* str, const char* suffix) {
-    if (!str || !suffix) {
-        str_last_error = STR_ERROR_NULL_INPUT;
-        return 0;
+#endif // STR_X86_DISPATCH
+
+// ---- Per-tier wrappers around the shared scan loops ----
+
+#define STR_DEFINE_SCAN_KERNELS(isa, target)                                              \
+    static target size_t str_validPrefix_##isa(const char* str, size_t len) {             \
+        size_t count;                                                                    \
+        return str_scanUTF8(str, len, str_asciiPrefix_##isa, &count);                    \
+    }                                                                                    \
+    static target int str_length_##isa(const char* str, size_t len) {                    \
+        size_t count;                                                                    \
+        return str_scanUTF8(str, len, str_asciiPrefix_##isa, &count) == len ? (int)count : -1; \
+    }                                                                                    \
+    static target size_t str_skipWhitespace_##isa(const char* str, size_t len) {         \
+        return str_skipWhitespaceWith(str, len, str_asciiWhitespace_##isa);              \
     }
 
-    int strLen = str_length(str);
-    int suffixLen = str_length(suffix);
+STR_DEFINE_SCAN_KERNELS(scalar, )
+#ifdef STR_X86_DISPATCH
+STR_DEFINE_SCAN_KERNELS(sse42, STR_TARGET_SSE42)
+STR_DEFINE_SCAN_KERNELS(avx2, STR_TARGET_AVX2)
+STR_DEFINE_SCAN_KERNELS(avx512, STR_TARGET_AVX512)
+#endif
+
+#define STR_KERNEL_TABLE(isa) {                                                          \
+    str_asciiPrefix_##isa, str_validPrefix_##isa, str_length_##isa, str_find_##isa,      \
+    str_mapAsciiCase_##isa, str_equalsFold_##isa, str_findFold_##isa,                    \
+    str_skipWhitespace_##isa,                                                            \
+    str_widenAscii16_##isa, str_widenAscii32_##isa, str_narrowAscii16_##isa,             \
+    str_narrowAscii32_##isa, str_countCrLf_##isa                                         \
+}
 
-    if (suffixLen > strLen) return 0;
+static const StrKernels str_kernelTables[] = {
+    STR_KERNEL_TABLE(scalar),
+#ifdef STR_X86_DISPATCH
+    STR_KERNEL_TABLE(sse42),
+    STR_KERNEL_TABLE(avx2),
+    STR_KERNEL_TABLE(avx512),
+#endif
+};
 
-    str += strLen - suffixLen;
+// ---- First-use resolution ----
+
+static void str_dispatchInit(void);
+
+static size_t str_asciiPrefix_resolve(const char* str, size_t len);
+static size_t str_validPrefix_resolve(const char* str, size_t len);
+static int str_length_resolve(const char* str, size_t len);
+static const char* str_find_resolve(const char* str, size_t len, const char* substr, size_t substrLen);
+static void str_mapAsciiCase_resolve(char* str, size_t len, bool upper);
+static bool str_equalsFold_resolve(const char* a, const char* b, size_t len);
+static const char* str_findFold_resolve(const char* str, size_t len, const char* substr, size_t substrLen);
+static size_t str_skipWhitespace_resolve(const char* str, size_t len);
+static size_t str_widenAscii16_resolve(const char* src, size_t len, uint16_t* dst, bool swap);
+static size_t str_widenAscii32_resolve(const char* src, size_t len, uint32_t* dst);
+static size_t str_narrowAscii16_resolve(const uint16_t* src, size_t len, char* dst, bool swap);
+static size_t str_narrowAscii32_resolve(const uint32_t* src, size_t len, char* dst);
+static size_t str_countCrLf_resolve(const char* str, size_t len);
+
+static const StrKernels str_resolveKernels = STR_KERNEL_TABLE(resolve);
+
+// The bound table is published with release stores and read with acquire loads, so a thread
+// that sees a tier's table also sees its contents. The tier is the table's index, so it can
+// never disagree with the kernels.
+static _Atomic(const StrKernels*) str_boundKernels = &str_resolveKernels;
+
+// Returns the kernel table currently bound
+static inline const StrKernels* str_loadKernels(void) {
+    return atomic_load_explicit(&str_boundKernels, memory_order_acquire);
+}
+
+static size_t str_asciiPrefix_resolve(const char* str, size_t len) {
+    str_dispatchInit();
+    return str_loadKernels()->asciiPrefix(str, len);
+}
+
+static size_t str_validPrefix_resolve(const char* str, size_t len) {
+    str_dispatchInit();
+    return str_loadKernels()->validPrefix(str, len);
+}
+
+static int str_length_resolve(const char* str, size_t len) {
+    str_dispatchInit();
+    return str_loadKernels()->length(str, len);
+}
+
+static const char* str_find_resolve(const char* str, size_t len, const char* substr, size_t substrLen) {
+    str_dispatchInit();
+    return str_loadKernels()->find(str, len, substr, substrLen);
+}
+
+static void str_mapAsciiCase_resolve(char* str, size_t len, bool upper) {
+    str_dispatchInit();
+    str_loadKernels()->mapAsciiCase(str, len, upper);
+}
+
+static bool str_equalsFold_resolve(const char* a, const char* b, size_t len) {
+    str_dispatchInit();
+    return str_loadKernels()->equalsFold(a, b, len);
+}
+
+static const char* str_findFold_resolve(const char* str, size_t len, const char* substr, size_t substrLen) {
+    str_dispatchInit();
+    return str_loadKernels()->findFold(str, len, substr, substrLen);
+}
+
+static size_t str_skipWhitespace_resolve(const char* str, size_t len) {
+    str_dispatchInit();
+    return str_loadKernels()->skipWhitespace(str, len);
+}
+
+static size_t str_widenAscii16_resolve(const char* src, size_t len, uint16_t* dst, bool swap) {
+    str_dispatchInit();
+    return str_loadKernels()->widenAscii16(src, len, dst, swap);
+}
+
+static size_t str_widenAscii32_resolve(const char* src, size_t len, uint32_t* dst) {
+    str_dispatchInit();
+    return str_loadKernels()->widenAscii32(src, len, dst);
+}
+
+static size_t str_narrowAscii16_resolve(const uint16_t* src, size_t len, char* dst, bool swap) {
+    str_dispatchInit();
+    return str_loadKernels()->narrowAscii16(src, len, dst, swap);
+}
+
+static size_t str_narrowAscii32_resolve(const uint32_t* src, size_t len, char* dst) {
+    str_dispatchInit();
+    return str_loadKernels()->narrowAscii32(src, len, dst);
+}
+
+static size_t str_countCrLf_resolve(const char* str, size_t len) {
+    str_dispatchInit();
+    return str_loadKernels()->countCrLf(str, len);
+}
+
+// Returns the best tier the running CPU supports
+static StrIsa str_detectIsa(void) {
+#ifdef STR_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) return STR_ISA_AVX512;
+    if (__builtin_cpu_supports("avx2")) return STR_ISA_AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return STR_ISA_SSE42;
+#endif
+    return STR_ISA_SCALAR;
+}
+
+// Detects the CPU and binds the kernels, honouring the STRLIB_ISA override
+static void str_dispatchInit(void) {
+    if (str_loadKernels() != &str_resolveKernels) return;
+
+    StrIsa isa = str_detectIsa();
+    const char* forced = getenv("STRLIB_ISA");
+    if (forced) {
+        for (int i = STR_ISA_SCALAR; i <= STR_ISA_AVX512; i++) {
+            if (strcmp(forced, str_isaNames[i]) == 0 && (StrIsa)i < isa) isa = (StrIsa)i;
+        }
+    }
+
+    // Threads racing through first use agree on the table; a str_forceIsa that got there first wins
+    const StrKernels* expected = &str_resolveKernels;
+    atomic_compare_exchange_strong_explicit(&str_boundKernels, &expected, &str_kernelTables[isa],
+                                            memory_order_release, memory_order_acquire);
+}
+
+// Returns the instruction set tier the kernels are bound to
+StrIsa str_activeIsa(void) {
+    str_dispatchInit();
+    return (StrIsa)(str_loadKernels() - str_kernelTables);
+}
+
+// Returns a printable name for an instruction set tier
+const char* str_isaName(StrIsa isa) {
+    if (isa < STR_ISA_SCALAR || isa > STR_ISA_AVX512) return NULL;
+    return str_isaNames[isa];
+}
+
+// Rebinds the kernels to the given tier, clamped to what the CPU supports
+StrIsa str_forceIsa(StrIsa isa) {
+    StrIsa best = str_detectIsa();
+    if (isa < STR_ISA_SCALAR) isa = STR_ISA_SCALAR;
+    if (isa > best) isa = best;
+
+    atomic_store_explicit(&str_boundKernels, &str_kernelTables[isa], memory_order_release);
+    return isa;
+}
+
+// Counts the code points in the first len bytes of str
+static int str_countCodePoints(const char* str, size_t len) {
+    int count = str_loadKernels()->length(str, len);
+    if (count >= 0) return count;
+
+    // Malformed input: count each maximal ill-formed subpart as one, as the iterator does
+    const unsigned char* bytes = (const unsigned char*)str;
+    uint32_t codePoint;
+    count = 0;
+    for (size_t i = 0; i < len; count++) {
+        int seqLen = str_utf8Decode(bytes + i, len - i, &codePoint);
+        i += seqLen < 0 ? -seqLen : seqLen;
+    }
+    return count;
+}
+
+// ==== INSTRUMENTATION ====
+// Compiled in only with -DSTRLIB_STATS. Each thread records into its own counter block,
+// so the hot path never contends; blocks are linked into a global list once and kept
+// after the thread exits so its totals still show up in snapshots.
+
+static const char* const str_functionNames[STR_FN_COUNT] = {
+    [STR_FN_IS_VALID_UTF8] = "str_isValidUTF8",
+    [STR_FN_LENGTH] = "str_length",
+    [STR_FN_CHAR_AT] = "str_charAt",
+    [STR_FN_CHAR_CODE_AT] = "str_charCodeAt",
+    [STR_FN_INDEX_OF] = "str_indexOf",
+    [STR_FN_LAST_INDEX_OF] = "str_lastIndexOf",
+    [STR_FN_CONCAT] = "str_concat",
+    [STR_FN_TO_LOWER_CASE] = "str_toLowerCase",
+    [STR_FN_TO_UPPER_CASE] = "str_toUpperCase",
+    [STR_FN_TRIM_START] = "str_trimStart",
+    [STR_FN_TRIM_END] = "str_trimEnd",
+    [STR_FN_REPEAT] = "str_repeat",
+    [STR_FN_STARTS_WITH] = "str_startsWith",
+    [STR_FN_ENDS_WITH] = "str_endsWith",
+    [STR_FN_SLICE] = "str_slice",
+    [STR_FN_SUBSTRING] = "str_substring",
+    [STR_FN_FROM_CODE_POINT] = "str_fromCodePoint",
+    [STR_FN_INCLUDES] = "str_includes",
+    [STR_FN_PAD_START] = "str_padStart",
+    [STR_FN_PAD_END] = "str_padEnd",
+    [STR_FN_REPLACE] = "str_replace",
+    [STR_FN_NORMALIZE] = "str_normalize",
+    [STR_FN_TO_WELL_FORMED] = "str_toWellFormed",
+    [STR_FN_TO_UTF16] = "str_toUTF16",
+    [STR_FN_TO_UTF32] = "str_toUTF32",
+    [STR_FN_FROM_UTF16] = "str_fromUTF16",
+    [STR_FN_FROM_UTF32] = "str_fromUTF32",
+    [STR_FN_SEARCH] = "str_search",
+    [STR_FN_MATCH] = "str_match",
+    [STR_FN_MATCH_ALL] = "str_matchAll",
+    [STR_FN_INDEX_OF_IGNORE_CASE] = "str_indexOfIgnoreCase",
+    [STR_FN_INCLUDES_IGNORE_CASE] = "str_includesIgnoreCase",
+    [STR_FN_FIND_ALL] = "str_findAll",
+    [STR_FN_COUNT_OCCURRENCES] = "str_count",
+    [STR_FN_CODE_POINT_AT] = "str_codePointAt",
+    [STR_FN_GRAPHEME_LENGTH] = "str_graphemeLength",
+    [STR_FN_GRAPHEME_AT] = "str_graphemeAt",
+    [STR_FN_TRUNCATE_GRAPHEMES] = "str_truncateGraphemes",
+};
+
+#ifdef STRLIB_STATS
+#include <time.h>
+
+typedef struct {
+    atomic_ullong calls;
+    atomic_ullong bytes;
+    atomic_ullong allocations;
+    atomic_ullong nanos;
+    atomic_ullong histogram[STR_STATS_BUCKETS];
+} StrStatsCounters;
+
+typedef struct StrStatsBlock {
+    StrStatsCounters functions[STR_FN_COUNT];
+    struct StrStatsBlock* next;
+} StrStatsBlock;
+
+typedef struct {
+    StrFunction fn;
+    unsigned long long start;
+    unsigned long long bytes;
+} StrStatsScope;
+
+static _Atomic(StrStatsBlock*) str_statsBlocks = NULL;
+static _Thread_local StrStatsBlock* str_statsLocal = NULL;
+
+// Only the owning thread writes a block, so a relaxed load/store pair is enough
+#define STR_STATS_ADD(counter, n) \
+    atomic_store_explicit(&(counter), atomic_load_explicit(&(counter), memory_order_relaxed) + (n), memory_order_relaxed)
+
+static unsigned long long str_statsNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+// Returns the calling thread's counter block, registering it on first use
+static StrStatsBlock* str_statsBlock(void) {
+    StrStatsBlock* block = str_statsLocal;
+    if (block) return block;
+
+    block = calloc(1, sizeof(StrStatsBlock));
+    if (!block) return NULL;
+
+    StrStatsBlock* head = atomic_load(&str_statsBlocks);
+    do {
+        block->next = head;
+    } while (!atomic_compare_exchange_weak(&str_statsBlocks, &head, block));
+
+    return (str_statsLocal = block);
+}
+
+static StrStatsScope str_statsBegin(StrFunction fn) {
+    StrStatsScope scope = { fn, str_statsNow(), 0 };
+    return scope;
+}
+
+static void str_statsEnd(StrStatsScope* scope) {
+    unsigned long long elapsed = str_statsNow() - scope->start;
+    StrStatsBlock* block = str_statsBlock();
+    if (!block) return;
+
+    // Bucket b holds calls that took [2^b, 2^(b+1)) nanoseconds
+    int bucket = elapsed ? 63 - __builtin_clzll(elapsed) : 0;
+    if (bucket >= STR_STATS_BUCKETS) bucket = STR_STATS_BUCKETS - 1;
+
+    StrStatsCounters* counters = &block->functions[scope->fn];
+    STR_STATS_ADD(counters->calls, 1);
+    STR_STATS_ADD(counters->bytes, scope->bytes);
+    STR_STATS_ADD(counters->nanos, elapsed);
+    STR_STATS_ADD(counters->histogram[bucket], 1);
+}
+
+static void str_statsAllocation(StrFunction fn) {
+    StrStatsBlock* block = str_statsBlock();
+    if (block) STR_STATS_ADD(block->functions[fn].allocations, 1);
+}
+
+// Opens a timed scope that is closed automatically on every return path
+#define STR_STATS_SCOPE(fn) \
+    StrStatsScope str_statsScope __attribute__((cleanup(str_statsEnd))) = str_statsBegin(fn)
+#define STR_STATS_BYTES(n) (str_statsScope.bytes = (unsigned long long)(n))
+#define STR_STATS_ALLOCATION() str_statsAllocation(str_statsScope.fn)
+
+#else
+
+// Without STRLIB_STATS the hooks expand to nothing and their arguments are never evaluated
+#define STR_STATS_SCOPE(fn) ((void)0)
+#define STR_STATS_BYTES(n) ((void)0)
+#define STR_STATS_ALLOCATION() ((void)0)
+
+#endif // STRLIB_STATS
+
+// Returns true when the library was built with STRLIB_STATS
+bool str_stats_enabled(void) {
+#ifdef STRLIB_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Returns the name of an instrumented function
+const char* str_functionName(StrFunction fn) {
+    if (fn < 0 || fn >= STR_FN_COUNT) return NULL;
+    return str_functionNames[fn];
+}
+
+// Sums the counters of every thread into stats
+StrError str_stats_snapshot(StrStats* stats) {
+    if (!stats) return (str_last_error = STR_ERROR_NULL_INPUT);
+
+    memset(stats, 0, sizeof(*stats));
+#ifdef STRLIB_STATS
+    for (StrStatsBlock* block = atomic_load(&str_statsBlocks); block; block = block->next) {
+        for (int fn = 0; fn < STR_FN_COUNT; fn++) {
+            StrStatsCounters* counters = &block->functions[fn];
+            StrFunctionStats* total = &stats->functions[fn];
+            total->calls += atomic_load_explicit(&counters->calls, memory_order_relaxed);
+            total->bytes += atomic_load_explicit(&counters->bytes, memory_order_relaxed);
+            total->allocations += atomic_load_explicit(&counters->allocations, memory_order_relaxed);
+            total->nanos += atomic_load_explicit(&counters->nanos, memory_order_relaxed);
+            for (int b = 0; b < STR_STATS_BUCKETS; b++) {
+                total->histogram[b] += atomic_load_explicit(&counters->histogram[b], memory_order_relaxed);
+            }
+        }
+    }
+#endif
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Zeroes the counters of every thread; calls racing with the reset may be partially kept
+void str_stats_reset(void) {
+#ifdef STRLIB_STATS
+    for (StrStatsBlock* block = atomic_load(&str_statsBlocks); block; block = block->next) {
+        for (int fn = 0; fn < STR_FN_COUNT; fn++) {
+            StrStatsCounters* counters = &block->functions[fn];
+            atomic_store_explicit(&counters->calls, 0, memory_order_relaxed);
+            atomic_store_explicit(&counters->bytes, 0, memory_order_relaxed);
+            atomic_store_explicit(&counters->allocations, 0, memory_order_relaxed);
+            atomic_store_explicit(&counters->nanos, 0, memory_order_relaxed);
+            for (int b = 0; b < STR_STATS_BUCKETS; b++) {
+                atomic_store_explicit(&counters->histogram[b], 0, memory_order_relaxed);
+            }
+        }
+    }
+#endif
+}
+
+// Returns the upper bound in nanoseconds of the bucket holding the given percentile
+static unsigned long long str_statsPercentile(const StrFunctionStats* stats, double percentile) {
+    unsigned long long rank = (unsigned long long)(stats->calls * percentile);
+    unsigned long long seen = 0;
+    for (int b = 0; b < STR_STATS_BUCKETS; b++) {
+        seen += stats->histogram[b];
+        if (seen > rank) return 2ULL << b;
+    }
+    return 2ULL << (STR_STATS_BUCKETS - 1);
+}
+
+// Writes a table of every function that has been called to out
+void str_stats_dump(FILE* out) {
+    if (!out) return;
+
+    if (!str_stats_enabled()) {
+        fprintf(out, "strlib statistics are disabled (build with -DSTRLIB_STATS)\n");
+        return;
+    }
+
+    StrStats stats;
+    str_stats_snapshot(&stats);
+
+    fprintf(out, "%-20s %12s %14s %10s %10s %10s %10s\n",
+            "function", "calls", "bytes", "allocs", "avg ns", "p50 ns", "p99 ns");
+    for (int fn = 0; fn < STR_FN_COUNT; fn++) {
+        const StrFunctionStats* s = &stats.functions[fn];
+        if (!s->calls) continue;
+        fprintf(out, "%-20s %12llu %14llu %10llu %10llu %10llu %10llu\n",
+                str_functionNames[fn], s->calls, s->bytes, s->allocations, s->nanos / s->calls,
+                str_statsPercentile(s, 0.50), str_statsPercentile(s, 0.99));
+    }
+}
+
+// Copies characters from src to dest from start to end
+StrError str_copyRange(const char* src, int start, int end, char* dest) {
+    if (!src || !dest) return (str_last_error = STR_ERROR_NULL_INPUT);
+
+    StrIter it;
+    str_iterInit(&it, src);
+    int i = 0;
+    while (i < start && str_iterNext(&it) != STR_ITER_END) i++;
+
+    const char* from = it.pos;
+    while (i < end && str_iterNext(&it) != STR_ITER_END) i++;
+
+    size_t len = it.pos - from;
+    memmove(dest, from, len);
+    dest[len] = '\0';
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Finds the first occurrence of a substring in a string
+const char* str_find(const char* str, const char* substr, int start) {
+    if (!str || !substr) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return NULL;
+    }
+    if (start < 0) {
+        str_last_error = STR_ERROR_INVALID_INDEX;
+        return NULL;
+    }
+
+    StrIter it;
+    str_iterInit(&it, str);
+    for (int i = 0; i < start && str_iterNext(&it) != STR_ITER_END; i++) {}
+
+    return str_findHelper(it.pos, substr);
+}
+
+// Helper function to find the substring in the string
+const char* str_findHelper(const char* str, const char* substr) {
+    if (!str || !substr) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return NULL;
+    }
+
+    // Byte matches of well-formed UTF-8 always start on a code point boundary
+    str_last_error = STR_SUCCESS;
+    return str_loadKernels()->find(str, strlen(str), substr, strlen(substr));
+}
+
+// Copies characters from src to dest until the delimiter is found
+StrError str_copyUntil(const char* src, const char* delimiter, char* dest) {
+    if (!src || !delimiter || !dest) return (str_last_error = STR_ERROR_NULL_INPUT);
+
+    const char* pos = str_find(src, delimiter, 0);
+    size_t len = pos ? (size_t)(pos - src) : strlen(src);
+    memmove(dest, src, len);
+    dest[len] = '\0';
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Checks if a Unicode code point is a whitespace character
+int str_isUnicodeWhitespace(int codePoint) {
+    int size = sizeof(unicodeWhitespace) / sizeof(unicodeWhitespace[0]);
+    for (int i = 0; i < size; i++) {
+        if (unicodeWhitespace[i] == codePoint) return 1;
+    }
+    return 0;
+}
+
+// Checks if a character is a whitespace character
+int str_isWhitespace(const char* str) {
+    if (!str) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return 0;
+    }
+
+    StrIter it;
+    str_iterInit(&it, str);
+    int codePoint = str_iterNext(&it);
+    return (codePoint == 0x20 || codePoint == 0x09 || codePoint == 0x0A || 
+            codePoint == 0x0D || str_isUnicodeWhitespace(codePoint));
+}
+
+// Validates if a string is valid UTF-8
+bool str_isValidUTF8(const char* str) {
+    STR_STATS_SCOPE(STR_FN_IS_VALID_UTF8);
+    if (!str) return false;
+
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+    return str_loadKernels()->validPrefix(str, len) == len;
+}
+
+// Gets the length of the UTF-8 sequence starting with a byte
+int str_getUTF8SequenceLength(unsigned char byte) {
+    if (byte <= 0x7F) return 1;
+    else if ((byte & 0xE0) == 0xC0) return 2;
+    else if ((byte & 0xF0) == 0xE0) return 3;
+    else if ((byte & 0xF8) == 0xF0) return 4;
+    return -1;
+}
+
+// Returns the code point from a sequence of UTF-8 bytes
+int str_getCodePointFromBytes(const char* str, int seqLen) {
+    if (!str || seqLen < 1 || seqLen > 4) return -1;
+
+    // Read bytes unsigned so a high byte is never sign-extended
+    const unsigned char* bytes = (const unsigned char*)str;
+    int codePoint = 0;
+    if (seqLen == 1) return bytes[0];
+    if (seqLen == 2) {
+        codePoint = (bytes[0] & 0x1F) << 6;
+        codePoint |= (bytes[1] & 0x3F);
+    } else if (seqLen == 3) {
+        codePoint = (bytes[0] & 0x0F) << 12;
+        codePoint |= (bytes[1] & 0x3F) << 6;
+        codePoint |= (bytes[2] & 0x3F);
+    } else if (seqLen == 4) {
+        codePoint = (bytes[0] & 0x07) << 18;
+        codePoint |= (bytes[1] & 0x3F) << 12;
+        codePoint |= (bytes[2] & 0x3F) << 6;
+        codePoint |= (bytes[3] & 0x3F);
+    }
+    return codePoint;
+}
+
+// Gets the Unicode code point from the start of the string and advances the pointer
+int str_getUTF8CodePoint(const char** str) {
+    if (!str || !*str) return -1;
+
+    // An ill-formed sequence returns -1 but is still stepped over, so callers' loops advance
+    uint32_t codePoint;
+    int seqLen = str_utf8Decode((const unsigned char*)*str, 4, &codePoint);
+    if (seqLen < 0) {
+        *str -= seqLen;
+        return -1;
+    }
+    *str += seqLen;
+    return (int)codePoint;
+}
+
+// Returns the length of the string in code points
+int str_length(const char* str) {
+    STR_STATS_SCOPE(STR_FN_LENGTH);
+    if (!str) return -1;
+
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+    return str_loadKernels()->length(str, len);
+}
+
+// Returns the character at a specific index in a string
+char* str_charAt(const char* str, int index) {
+    STR_STATS_SCOPE(STR_FN_CHAR_AT);
+    if (!str || index < 0) return NULL;
+
+    StrIter it;
+    str_iterInit(&it, str);
+    for (int i = 0; ; i++) {
+        const char* start = it.pos;
+        if (str_iterNext(&it) == STR_ITER_END) break;
+        if (i == index) {
+            int len = it.pos - start;
+            char* result = malloc(len + 1);
+            if (!result) return NULL;
+            STR_STATS_ALLOCATION();
+            STR_STATS_BYTES(len);
+            memcpy(result, start, len);
+            result[len] = '\0';
+            return result;
+        }
+    }
+    return NULL;
+}
+
+// Returns the ASCII value of the character at a specific index in a string
+int str_charCodeAt(const char* str, int index) {
+    STR_STATS_SCOPE(STR_FN_CHAR_CODE_AT);
+    if (!str) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return -1;
+    }
+    if (index < 0) {
+        str_last_error = STR_ERROR_INVALID_INDEX;
+        return -1;
+    }
+
+    StrIter it;
+    str_iterInit(&it, str);
+    int codePoint;
+    for (int i = 0; (codePoint = str_iterNext(&it)) != STR_ITER_END; i++) {
+        if (i == index) {
+            str_last_error = STR_SUCCESS;
+            return codePoint;
+        }
+    }
+    str_last_error = STR_ERROR_INVALID_INDEX;
+    return -1;
+}
+
+// Stores the Unicode code point at a specific index in a string
+int str_codePointAt(const char* str, int index, int* codePoint) {
+    STR_STATS_SCOPE(STR_FN_CODE_POINT_AT);
+    if (!str || !codePoint) return (str_last_error = STR_ERROR_NULL_INPUT);
+    if (index < 0) return (str_last_error = STR_ERROR_INVALID_INDEX);
+
+    StrIter it;
+    str_iterInit(&it, str);
+    for (int i = 0; (*codePoint = str_iterNext(&it)) != STR_ITER_END; i++) {
+        if (i == index) return (str_last_error = STR_SUCCESS);
+    }
+    return (str_last_error = STR_ERROR_INVALID_INDEX);
+}
+
+// Returns the index of the first occurrence of a substring in a string
+int str_indexOf(const char* str, const char* substr) {
+    STR_STATS_SCOPE(STR_FN_INDEX_OF);
+    if (!str || !substr) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return -1;
+    }
+
+    const char* pos = str_findHelper(str, substr);
+    STR_STATS_BYTES(pos ? (size_t)(pos - str) + strlen(substr) : strlen(str));
+    if (!pos) return -1;
+    return str_countCodePoints(str, pos - str);
+}
+
+// Returns the index of the last occurrence of a substring in a string
+int str_lastIndexOf(const char* str, const char* substr) {
+    STR_STATS_SCOPE(STR_FN_LAST_INDEX_OF);
+    if (!str || !substr) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return -1;
+    }
+
+    // One forward pass over the matches, converting only the last one to a code point index
+    size_t len = strlen(str), substrLen = strlen(substr);
+    STR_STATS_BYTES(len);
+    str_last_error = STR_SUCCESS;
+    if (substrLen == 0) return str_countCodePoints(str, len);
+
+    const char* last = NULL;
+    const char* pos = str;
+    while ((pos = str_loadKernels()->find(pos, len - (pos - str), substr, substrLen))) {
+        last = pos++;
+    }
+    return last ? str_countCodePoints(str, last - str) : -1;
+}
+
+// Joins two strings together
+StrError str_concat(const char* str1, const char* str2, char* result) {
+    STR_STATS_SCOPE(STR_FN_CONCAT);
+    if (!str1 || !str2 || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+    STR_STATS_BYTES(strlen(str1) + strlen(str2));
+
+    // Whole-string moves; result may be str1 itself, as when padding in place
+    size_t len1 = strlen(str1), len2 = strlen(str2);
+    memmove(result, str1, len1);
+    memmove(result + len1, str2, len2);
+    result[len1 + len2] = '\0';
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Converts the entire string to lowercase
+StrError str_toLowerCase(char* str) {
+    STR_STATS_SCOPE(STR_FN_TO_LOWER_CASE);
+    if (!str) return (str_last_error = STR_ERROR_NULL_INPUT);
+
+    // Multi-byte UTF-8 sequences never contain ASCII bytes, so a byte-wise map is safe
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+    str_loadKernels()->mapAsciiCase(str, len, false);
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Converts the entire string to uppercase
+StrError str_toUpperCase(char* str) {
+    STR_STATS_SCOPE(STR_FN_TO_UPPER_CASE);
+    if (!str) return (str_last_error = STR_ERROR_NULL_INPUT);
+
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+    str_loadKernels()->mapAsciiCase(str, len, true);
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Removes leading whitespace from a string
+StrError str_trimStart(char* str) {
+    STR_STATS_SCOPE(STR_FN_TRIM_START);
+    if (!str) return (str_last_error = STR_ERROR_NULL_INPUT);
+
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+    size_t skip = str_loadKernels()->skipWhitespace(str, len);
+    memmove(str, str + skip, len - skip + 1);
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Removes trailing whitespace from a string
+StrError str_trimEnd(char* str) {
+    STR_STATS_SCOPE(STR_FN_TRIM_END);
+    if (!str || !*str) return (str_last_error = STR_ERROR_NULL_INPUT);
+
+    char* end = str + strlen(str);
+    STR_STATS_BYTES(end - str);
+    char* last = end - 1;
+
+    while (last >= str) {
+        while (last > str && (*last & 0xC0) == 0x80) {
+            last--;
+        }
+        
+        if (!str_isWhitespace(last)) break;
+        
+        end = last;
+        last = end - 1;
+    }
+
+    *end = '\0';
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Trims whitespace from both ends of the string
+StrError str_trim(char* str) {
+    str_trimStart(str);
+    str_trimEnd(str);
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Repeats a string a given number of times
+StrError str_repeat(const char* str, int count, char* result) {
+    STR_STATS_SCOPE(STR_FN_REPEAT);
+    if (!str || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+    if (count < 0) return (str_last_error = STR_ERROR_INVALID_INDEX);
+
+    int strLen = str_length(str);
+    if (strLen == -1) return (str_last_error = STR_ERROR_INVALID_UTF8);
+
+    STR_STATS_BYTES((size_t)strLen * count);
+    for (int i = 0; i < count; i++) {
+        strncpy(result, str, strLen);
+        result += strLen;
+    }
+
+    *result = '\0';
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Check if a string starts with a given prefix
+int str_startsWith(const char* str, const char* prefix) {
+    STR_STATS_SCOPE(STR_FN_STARTS_WITH);
+    if (!str || !prefix) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return 0;
+    }
+
+    while (*prefix) {
+        if (*str++ != *prefix++) return 0;
+    }
+
+    return 1;
+}
+
+// Check if a string ends with a given suffix
+int str_endsWith(const char* str, const char* suffix) {
+    STR_STATS_SCOPE(STR_FN_ENDS_WITH);
+    if (!str || !suffix) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return 0;
+    }
+
+    int strLen = str_length(str);
+    int suffixLen = str_length(suffix);
+
+    if (suffixLen > strLen) return 0;
+
+    str += strLen - suffixLen;
+
+    while (*suffix) {
+        if (*str++ != *suffix++) return 0;
+    }
+
+    return 1;
+}
+
+// Check if a string includes a given substring
+int str_includes(const char* str, const char* substr) {
+    STR_STATS_SCOPE(STR_FN_INCLUDES);
+    if (!str || !substr) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return 0;
+    }
+
+    return str_findHelper(str, substr) != NULL;
+}
+
+// Extracts a substring from a string and stores it in result
+void str_slice(const char* str, int start, int end, char* result) {
+    STR_STATS_SCOPE(STR_FN_SLICE);
+    if (!str || !result) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return;
+    }
+
+    str_copyRange(str, start, end, result);
+}
+
+// Extracts a substring from a string and stores it in result
+StrError str_substring(const char* str, int start, int end, char* result) {
+    STR_STATS_SCOPE(STR_FN_SUBSTRING);
+    if (!str || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+
+    StrIter it;
+    str_iterInit(&it, str);
+    int i = 0;
+    while (i < start && str_iterNext(&it) != STR_ITER_END) i++;
+
+    const char* startPtr = it.pos;
+    while (i < end && str_iterNext(&it) != STR_ITER_END) i++;
+
+    size_t len = it.pos - startPtr;
+    STR_STATS_BYTES(len);
+    memcpy(result, startPtr, len);
+    result[len] = '\0';
+    return (str_last_error = STR_SUCCESS);
+}
+
+
+// Pads a string with a given character at the start to reach a target length
+StrError str_padStart(const char* str, int targetLength, const char* padStr, char* result, size_t resultSize) {
+    STR_STATS_SCOPE(STR_FN_PAD_START);
+    if (!str || !padStr || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+
+    int strLen = str_length(str);
+    int padLen = str_length(padStr);
+    if (targetLength <= strLen || targetLength >= resultSize) return (str_last_error = STR_ERROR_INVALID_INDEX);
+
+    char temp[resultSize];
+    temp[0] = '\0';
+
+    int padCount = targetLength - strLen;
+    while (padCount > padLen) {
+        str_concat(temp, padStr, temp);
+        padCount -= padLen;
+    }
+    while (padCount-- > 0) strncat(temp, padStr, 1);
+
+    str_concat(temp, str, result);
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Pads a string with a given character at the end to reach a target length
+StrError str_padEnd(const char* str, int targetLength, const char* padStr, char* result, size_t resultSize) {
+    STR_STATS_SCOPE(STR_FN_PAD_END);
+    if (!str || !padStr || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+
+    int strLen = str_length(str);
+    int padLen = str_length(padStr);
+    if (targetLength >= resultSize) return (str_last_error = STR_ERROR_MEMORY_ALLOCATION);
+
+    str_concat(str, "", result);
+
+    int padCount = targetLength - strLen;
+    while (padCount > padLen) {
+        str_concat(result, padStr, result);
+        padCount -= padLen;
+    }
+    while (padCount-- > 0) strncat(result, padStr, 1);
+
+    result[targetLength] = '\0';
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Replaces all occurrences of a substring with another substring in a string
+StrError str_replace(const char* str, const char* searchValue, const char* newValue, char* result) {
+    STR_STATS_SCOPE(STR_FN_REPLACE);
+    if (!str || !searchValue || !newValue || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+    STR_STATS_BYTES(strlen(str));
+
+    const char* pos = str;
+    int searchLenBytes = strlen(searchValue);
+    int newValueLenBytes = strlen(newValue);
+
+    while ((pos = str_findHelper(pos, searchValue)) != NULL) {
+        int bytesToCopy = pos - str;
+        strncpy(result, str, bytesToCopy);
+        result += bytesToCopy;
+        strcpy(result, newValue);
+        result += newValueLenBytes;
+        str = pos + searchLenBytes;
+        pos = str;
+    }
+
+    strcpy(result, str);
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Converts a Unicode code point to a newly allocated UTF-8 string
+char* str_fromCodePoint(int codePoint) {
+    STR_STATS_SCOPE(STR_FN_FROM_CODE_POINT);
+    if (codePoint < 0 || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+        str_last_error = STR_ERROR_INVALID_INDEX;
+        return NULL;
+    }
+
+    char* result = malloc(5);
+    if (!result) {
+        str_last_error = STR_ERROR_MEMORY_ALLOCATION;
+        return NULL;
+    }
+    STR_STATS_ALLOCATION();
+
+    unsigned char* out = (unsigned char*)result;
+    if (codePoint < 0x80) {
+        *out++ = codePoint;
+    } else if (codePoint < 0x800) {
+        *out++ = 0xC0 | (codePoint >> 6);
+        *out++ = 0x80 | (codePoint & 0x3F);
+    } else if (codePoint < 0x10000) {
+        *out++ = 0xE0 | (codePoint >> 12);
+        *out++ = 0x80 | ((codePoint >> 6) & 0x3F);
+        *out++ = 0x80 | (codePoint & 0x3F);
+    } else {
+        *out++ = 0xF0 | (codePoint >> 18);
+        *out++ = 0x80 | ((codePoint >> 12) & 0x3F);
+        *out++ = 0x80 | ((codePoint >> 6) & 0x3F);
+        *out++ = 0x80 | (codePoint & 0x3F);
+    }
+    *out = '\0';
+
+    STR_STATS_BYTES((char*)out - result);
+    str_last_error = STR_SUCCESS;
+    return result;
+}
+
+// ==== UNICODE NORMALIZATION ====
+// UAX #15 normalization over the tables in strlib_normalize_tables.h. The quick check
+// runs first; text it proves normalized is copied through without touching the heap.
+
+#define STR_QC_YES 0
+#define STR_QC_NO 1
+#define STR_QC_MAYBE 2
+
+#define STR_HANGUL_S_BASE 0xAC00
+#define STR_HANGUL_L_BASE 0x1100
+#define STR_HANGUL_V_BASE 0x1161
+#define STR_HANGUL_T_BASE 0x11A7
+#define STR_HANGUL_L_COUNT 19
+#define STR_HANGUL_V_COUNT 21
+#define STR_HANGUL_T_COUNT 28
+#define STR_HANGUL_N_COUNT (STR_HANGUL_V_COUNT * STR_HANGUL_T_COUNT)
+#define STR_HANGUL_S_COUNT (STR_HANGUL_L_COUNT * STR_HANGUL_N_COUNT)
+
+// Growable array of code points used by the slow normalization path
+typedef struct {
+    uint32_t* data;
+    size_t length;
+    size_t capacity;
+} StrCodePointBuffer;
+
+static bool str_codePointBufferPush(StrCodePointBuffer* buffer, uint32_t codePoint) {
+    if (buffer->length == buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 64;
+        uint32_t* data = realloc(buffer->data, capacity * sizeof(uint32_t));
+        if (!data) return false;
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    buffer->data[buffer->length++] = codePoint;
+    return true;
+}
+
+static unsigned str_normProps(uint32_t codePoint) {
+    unsigned block = str_normPropStage1[codePoint >> STR_NORM_BLOCK_SHIFT];
+    unsigned offset = codePoint & ((1u << STR_NORM_BLOCK_SHIFT) - 1);
+    return str_normPropValues[str_normPropStage2[(block << STR_NORM_BLOCK_SHIFT) | offset]];
+}
+
+static int str_combiningClass(uint32_t codePoint) {
+    return str_normProps(codePoint) & 0xFF;
+}
+
+static int str_quickCheckValue(unsigned props, StrNormalizationForm form) {
+    switch (form) {
+        case STR_NFC: return (props >> 8) & 3;
+        case STR_NFD: return (props >> 10) & 1;
+        case STR_NFKC: return (props >> 11) & 3;
+        default: return (props >> 13) & 1;
+    }
+}
+
+static bool str_isCompatForm(StrNormalizationForm form) {
+    return form == STR_NFKC || form == STR_NFKD;
+}
+
+static bool str_isComposedForm(StrNormalizationForm form) {
+    return form == STR_NFC || form == STR_NFKC;
+}
+
+// Runs the UAX #15 quick check up to the first character that is not a definite Yes.
+// Returns STR_QC_* (or -1 for malformed UTF-8) and stores in safe the offset of the last
+// starter before that character; everything before it is already normalized.
+static int str_quickCheck(const char* str, size_t len, StrNormalizationForm form, size_t* safe) {
+    const unsigned char* bytes = (const unsigned char*)str;
+    size_t i = 0;
+    int lastClass = 0;
+    *safe = 0;
+
+    while (i < len) {
+        if (bytes[i] < 0x80) {
+            i += str_loadKernels()->asciiPrefix(str + i, len - i);
+            *safe = i - 1;
+            lastClass = 0;
+            continue;
+        }
+
+        uint32_t codePoint;
+        int seqLen = str_decodeSequence(bytes + i, len - i, &codePoint);
+        if (!seqLen) return -1;
+
+        unsigned props = str_normProps(codePoint);
+        int combiningClass = props & 0xFF;
+        int check = str_quickCheckValue(props, form);
+        if (check != STR_QC_YES) return check;
+        if (combiningClass != 0 && lastClass > combiningClass) return STR_QC_NO;
+
+        if (combiningClass == 0) *safe = i;
+        lastClass = combiningClass;
+        i += seqLen;
+    }
+
+    *safe = len;
+    return STR_QC_YES;
+}
+
+static const StrDecomposition* str_findDecomposition(uint32_t codePoint) {
+    size_t lo = 0, hi = sizeof(str_decompositions) / sizeof(str_decompositions[0]);
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (str_decompositions[mid].codePoint < codePoint) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < sizeof(str_decompositions) / sizeof(str_decompositions[0]) &&
+        str_decompositions[lo].codePoint == codePoint) return &str_decompositions[lo];
+    return NULL;
+}
+
+// Appends the full canonical or compatibility decomposition of a code point
+static bool str_decompose(uint32_t codePoint, bool compat, StrCodePointBuffer* buffer) {
+    if (codePoint >= STR_HANGUL_S_BASE && codePoint < STR_HANGUL_S_BASE + STR_HANGUL_S_COUNT) {
+        uint32_t index = codePoint - STR_HANGUL_S_BASE;
+        uint32_t trailing = index % STR_HANGUL_T_COUNT;
+        if (!str_codePointBufferPush(buffer, STR_HANGUL_L_BASE + index / STR_HANGUL_N_COUNT)) return false;
+        if (!str_codePointBufferPush(buffer, STR_HANGUL_V_BASE + (index % STR_HANGUL_N_COUNT) / STR_HANGUL_T_COUNT)) return false;
+        return trailing == 0 || str_codePointBufferPush(buffer, STR_HANGUL_T_BASE + trailing);
+    }
+
+    const StrDecomposition* entry = str_findDecomposition(codePoint);
+    size_t offset = 0, length = 0;
+    if (entry) {
+        offset = entry->offset;
+        length = entry->canonicalLength;
+        if (compat && entry->compatLength) {
+            offset += entry->canonicalLength;
+            length = entry->compatLength;
+        }
+    }
+    if (length == 0) return str_codePointBufferPush(buffer, codePoint);
+
+    for (size_t i = 0; i < length; i++) {
+        if (!str_codePointBufferPush(buffer, str_decompositionPool[offset + i])) return false;
+    }
+    return true;
+}
+
+// Puts every run of non-starters into canonical order (stable by combining class)
+static void str_canonicalOrder(uint32_t* codePoints, size_t length) {
+    for (size_t i = 1; i < length; i++) {
+        uint32_t codePoint = codePoints[i];
+        int combiningClass = str_combiningClass(codePoint);
+        if (combiningClass == 0) continue;
+
+        size_t j = i;
+        while (j > 0) {
+            int previousClass = str_combiningClass(codePoints[j - 1]);
+            if (previousClass <= combiningClass) break;
+            codePoints[j] = codePoints[j - 1];
+            j--;
+        }
+        codePoints[j] = codePoint;
+    }
+}
+
+// Returns the primary composite of a pair, or 0 if there is none
+static uint32_t str_composePair(uint32_t first, uint32_t second) {
+    if (first >= STR_HANGUL_L_BASE && first < STR_HANGUL_L_BASE + STR_HANGUL_L_COUNT &&
+        second >= STR_HANGUL_V_BASE && second < STR_HANGUL_V_BASE + STR_HANGUL_V_COUNT) {
+        return STR_HANGUL_S_BASE + ((first - STR_HANGUL_L_BASE) * STR_HANGUL_V_COUNT +
+                                    (second - STR_HANGUL_V_BASE)) * STR_HANGUL_T_COUNT;
+    }
+    if (first >= STR_HANGUL_S_BASE && first < STR_HANGUL_S_BASE + STR_HANGUL_S_COUNT &&
+        (first - STR_HANGUL_S_BASE) % STR_HANGUL_T_COUNT == 0 &&
+        second > STR_HANGUL_T_BASE && second < STR_HANGUL_T_BASE + STR_HANGUL_T_COUNT) {
+        return first + (second - STR_HANGUL_T_BASE);
+    }
+
+    size_t lo = 0, hi = sizeof(str_compositions) / sizeof(str_compositions[0]);
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        const StrComposition* entry = &str_compositions[mid];
+        if (entry->first < first || (entry->first == first && entry->second < second)) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < sizeof(str_compositions) / sizeof(str_compositions[0]) &&
+        str_compositions[lo].first == first && str_compositions[lo].second == second) {
+        return str_compositions[lo].composite;
+    }
+    return 0;
+}
+
+// Applies canonical composition in place and returns the new length
+static size_t str_canonicalCompose(uint32_t* codePoints, size_t length) {
+    if (length == 0) return 0;
+
+    size_t starterPos = 0;
+    uint32_t starter = codePoints[0];
+    int lastClass = str_combiningClass(starter);
+    if (lastClass != 0) lastClass = 256;  // A leading non-starter blocks every later mark
+
+    size_t out = 1;
+    for (size_t i = 1; i < length; i++) {
+        uint32_t codePoint = codePoints[i];
+        int combiningClass = str_combiningClass(codePoint);
+        uint32_t composite = str_composePair(starter, codePoint);
+
+        if (composite && (lastClass < combiningClass || lastClass == 0)) {
+            codePoints[starterPos] = composite;
+            starter = composite;
+            continue;
+        }
+
+        if (combiningClass == 0) {
+            starterPos = out;
+            starter = codePoint;
+        }
+        lastClass = combiningClass;
+        codePoints[out++] = codePoint;
+    }
+    return out;
+}
+
+static size_t str_encodedLength(uint32_t codePoint) {
+    return codePoint < 0x80 ? 1 : codePoint < 0x800 ? 2 : codePoint < 0x10000 ? 3 : 4;
+}
+
+static char* str_encodeCodePoint(uint32_t codePoint, char* out) {
+    unsigned char* bytes = (unsigned char*)out;
+    if (codePoint < 0x80) {
+        *bytes++ = codePoint;
+    } else if (codePoint < 0x800) {
+        *bytes++ = 0xC0 | (codePoint >> 6);
+        *bytes++ = 0x80 | (codePoint & 0x3F);
+    } else if (codePoint < 0x10000) {
+        *bytes++ = 0xE0 | (codePoint >> 12);
+        *bytes++ = 0x80 | ((codePoint >> 6) & 0x3F);
+        *bytes++ = 0x80 | (codePoint & 0x3F);
+    } else {
+        *bytes++ = 0xF0 | (codePoint >> 18);
+        *bytes++ = 0x80 | ((codePoint >> 12) & 0x3F);
+        *bytes++ = 0x80 | ((codePoint >> 6) & 0x3F);
+        *bytes++ = 0x80 | (codePoint & 0x3F);
+    }
+    return (char*)bytes;
+}
+
+// Decomposes, reorders and (for NFC/NFKC) recomposes len bytes of str into buffer
+static StrError str_normalizeCodePoints(const char* str, size_t len, StrNormalizationForm form,
+                                        StrCodePointBuffer* buffer) {
+    const unsigned char* bytes = (const unsigned char*)str;
+    bool compat = str_isCompatForm(form);
+
+    for (size_t i = 0; i < len;) {
+        uint32_t codePoint;
+        int seqLen = str_decodeSequence(bytes + i, len - i, &codePoint);
+        if (!seqLen) return STR_ERROR_INVALID_UTF8;
+        if (!str_decompose(codePoint, compat, buffer)) return STR_ERROR_MEMORY_ALLOCATION;
+        i += seqLen;
+    }
+
+    str_canonicalOrder(buffer->data, buffer->length);
+    if (str_isComposedForm(form)) buffer->length = str_canonicalCompose(buffer->data, buffer->length);
+    return STR_SUCCESS;
+}
+
+// Checks if a string is already in the given normalization form
+bool str_isNormalized(const char* str, StrNormalizationForm form) {
+    if (!str) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return false;
+    }
+
+    size_t len = strlen(str);
+    size_t safe;
+    int check = str_quickCheck(str, len, form, &safe);
+    if (check == -1) {
+        str_last_error = STR_ERROR_INVALID_UTF8;
+        return false;
+    }
+    str_last_error = STR_SUCCESS;
+    if (check != STR_QC_MAYBE) return check == STR_QC_YES;
+
+    // Maybe: normalize the undecided tail and compare it with the input
+    StrCodePointBuffer buffer = { NULL, 0, 0 };
+    StrError error = str_normalizeCodePoints(str + safe, len - safe, form, &buffer);
+    bool normalized = error == STR_SUCCESS;
+
+    const char* pos = str + safe;
+    for (size_t i = 0; normalized && i < buffer.length; i++) {
+        char encoded[4];
+        size_t encodedLen = str_encodeCodePoint(buffer.data[i], encoded) - encoded;
+        if ((size_t)(str + len - pos) < encodedLen || memcmp(pos, encoded, encodedLen) != 0) normalized = false;
+        pos += encodedLen;
+    }
+    if (normalized && pos != str + len) normalized = false;
+
+    free(buffer.data);
+    if (error != STR_SUCCESS) str_last_error = error;
+    return normalized;
+}
+
+// Normalizes a string into result; result may be str itself
+StrError str_normalize(const char* str, StrNormalizationForm form, char* result, size_t resultSize) {
+    STR_STATS_SCOPE(STR_FN_NORMALIZE);
+    if (!str || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+    if (form < STR_NFC || form > STR_NFKD) return (str_last_error = STR_ERROR_INVALID_INDEX);
+
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+
+    size_t safe;
+    int check = str_quickCheck(str, len, form, &safe);
+    if (check == -1) return (str_last_error = STR_ERROR_INVALID_UTF8);
+
+    if (check == STR_QC_YES) {
+        if (len >= resultSize) return (str_last_error = STR_ERROR_BUFFER_TOO_SMALL);
+        if (result != str) memcpy(result, str, len + 1);
+        return (str_last_error = STR_SUCCESS);
+    }
+
+    StrCodePointBuffer buffer = { NULL, 0, 0 };
+    StrError error = str_normalizeCodePoints(str + safe, len - safe, form, &buffer);
+    if (error != STR_SUCCESS) {
+        free(buffer.data);
+        return (str_last_error = error);
+    }
+
+    size_t outLen = safe;
+    for (size_t i = 0; i < buffer.length; i++) outLen += str_encodedLength(buffer.data[i]);
+    if (outLen >= resultSize) {
+        free(buffer.data);
+        return (str_last_error = STR_ERROR_BUFFER_TOO_SMALL);
+    }
+
+    // The tail is fully decoded already, so writing over str is safe
+    if (result != str) memcpy(result, str, safe);
+    char* out = result + safe;
+    for (size_t i = 0; i < buffer.length; i++) out = str_encodeCodePoint(buffer.data[i], out);
+    *out = '\0';
+
+    free(buffer.data);
+    return (str_last_error = STR_SUCCESS);
+}
+
+// ==== WELL-FORMED UTF-8 ====
+
+// Returns the length of the maximal subpart of the ill-formed sequence at str: the
+// longest prefix of a well-formed sequence, or 1 if the lead byte cannot start one
+static int str_maximalSubpartLength(const unsigned char* str, size_t avail) {
+    uint32_t codePoint;
+    int seqLen = str_utf8Decode(str, avail, &codePoint);
+    return seqLen < 0 ? -seqLen : seqLen;
+}
+
+// Checks if a string is well-formed UTF-8
+bool str_isWellFormed(const char* str) {
+    return str_isValidUTF8(str);
+}
+
+// Copies a string into result, replacing each maximal ill-formed subpart with U+FFFD.
+// result may be str itself, in which case only the bytes from the first error onwards move.
+StrError str_toWellFormed(const char* str, char* result, size_t resultSize) {
+    STR_STATS_SCOPE(STR_FN_TO_WELL_FORMED);
+    if (!str || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+
+    size_t valid = str_loadKernels()->validPrefix(str, len);
+    if (valid == len) {
+        if (len >= resultSize) return (str_last_error = STR_ERROR_BUFFER_TOO_SMALL);
+        if (result != str) memcpy(result, str, len + 1);
+        return (str_last_error = STR_SUCCESS);
+    }
+
+    // Size the output: valid runs are kept, every maximal subpart (1-3 bytes) becomes 3 bytes
+    const unsigned char* bytes = (const unsigned char*)str;
+    size_t outLen = valid;
+    for (size_t i = valid; i < len;) {
+        size_t run = str_loadKernels()->validPrefix(str + i, len - i);
+        outLen += run;
+        i += run;
+        if (i == len) break;
+        i += str_maximalSubpartLength(bytes + i, len - i);
+        outLen += 3;
+    }
+    if (outLen >= resultSize) return (str_last_error = STR_ERROR_BUFFER_TOO_SMALL);
+
+    // In place, park the damaged tail at the end of the output first. Replacements never
+    // shrink, so the write position can then never overtake the read position.
+    const char* src = str + valid;
+    size_t srcLen = len - valid;
+    if (result == str) {
+        memmove(result + outLen - srcLen, src, srcLen);
+        src = result + outLen - srcLen;
+    } else {
+        memcpy(result, str, valid);
+    }
+
+    char* out = result + valid;
+    for (size_t i = 0; i < srcLen;) {
+        size_t run = str_loadKernels()->validPrefix(src + i, srcLen - i);
+        memmove(out, src + i, run);
+        out += run;
+        i += run;
+        if (i == srcLen) break;
+
+        i += str_maximalSubpartLength((const unsigned char*)src + i, srcLen - i);
+        *out++ = (char)0xEF;
+        *out++ = (char)0xBF;
+        *out++ = (char)0xBD;
+    }
+    *out = '\0';
+
+    return (str_last_error = STR_SUCCESS);
+}
+
+// ==== TRANSCODING ====
+// UTF-8 <-> UTF-16 / UTF-32. ASCII runs go through the dispatched widen/narrow kernels;
+// everything else is decoded, validated and re-encoded one code point at a time.
+
+// Returns true when units in the given byte order must be swapped on this host
+static bool str_needsSwap(StrByteOrder order) {
+    const uint16_t probe = 1;
+    bool hostIsBigEndian = *(const unsigned char*)&probe == 0;
+    return (order == STR_BIG_ENDIAN) != hostIsBigEndian;
+}
+
+// Decodes one code point from UTF-16; returns the units consumed, or 0 for an unpaired surrogate
+static int str_decodeUTF16(const uint16_t* src, size_t avail, bool swap, uint32_t* codePoint) {
+    uint32_t unit = swap ? str_swap16(src[0]) : src[0];
+    if (unit < 0xD800 || unit > 0xDFFF) {
+        *codePoint = unit;
+        return 1;
+    }
+    if (unit > 0xDBFF || avail < 2) return 0;
+
+    uint32_t low = swap ? str_swap16(src[1]) : src[1];
+    if (low < 0xDC00 || low > 0xDFFF) return 0;
+    *codePoint = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+    return 2;
+}
+
+static bool str_isScalarValue(uint32_t codePoint) {
+    return codePoint <= 0x10FFFF && (codePoint < 0xD800 || codePoint > 0xDFFF);
+}
+
+// Returns the number of UTF-16 code units needed to hold a UTF-8 string
+int str_utf16Length(const char* str) {
+    if (!str) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return -1;
+    }
+
+    const unsigned char* bytes = (const unsigned char*)str;
+    size_t len = strlen(str);
+    size_t i = 0, units = 0;
+    while (i < len) {
+        size_t ascii = str_loadKernels()->asciiPrefix(str + i, len - i);
+        i += ascii;
+        units += ascii;
+
+        while (i < len && bytes[i] >= 0x80) {
+            int seqLen = str_decodeSequence(bytes + i, len - i, NULL);
+            if (!seqLen) {
+                str_last_error = STR_ERROR_INVALID_UTF8;
+                return -1;
+            }
+            units += seqLen == 4 ? 2 : 1;  // Supplementary planes need a surrogate pair
+            i += seqLen;
+        }
+    }
+
+    str_last_error = STR_SUCCESS;
+    return (int)units;
+}
+
+// Transcodes a UTF-8 string to zero-terminated UTF-16 in the given byte order
+StrError str_toUTF16(const char* str, StrByteOrder order, uint16_t* result, size_t resultSize) {
+    STR_STATS_SCOPE(STR_FN_TO_UTF16);
+    if (!str || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+    if (resultSize == 0) return (str_last_error = STR_ERROR_BUFFER_TOO_SMALL);
+
+    const unsigned char* bytes = (const unsigned char*)str;
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+
+    bool swap = str_needsSwap(order);
+    size_t capacity = resultSize - 1;  // Keep room for the terminating zero unit
+    size_t i = 0, out = 0;
+    while (i < len) {
+        size_t room = capacity - out;
+        size_t ascii = str_loadKernels()->widenAscii16(str + i, len - i < room ? len - i : room, result + out, swap);
+        i += ascii;
+        out += ascii;
+
+        // Multi-byte sequences, and ASCII that no longer fits, take the scalar path
+        while (i < len && (bytes[i] >= 0x80 || out == capacity)) {
+            uint32_t codePoint;
+            int seqLen = str_decodeSequence(bytes + i, len - i, &codePoint);
+            if (!seqLen) return (str_last_error = STR_ERROR_INVALID_UTF8);
+
+            if (codePoint < 0x10000) {
+                if (out + 1 > capacity) return (str_last_error = STR_ERROR_BUFFER_TOO_SMALL);
+                result[out++] = swap ? str_swap16((uint16_t)codePoint) : (uint16_t)codePoint;
+            } else {
+                if (out + 2 > capacity) return (str_last_error = STR_ERROR_BUFFER_TOO_SMALL);
+                uint16_t high = (uint16_t)(0xD800 | ((codePoint - 0x10000) >> 10));
+                uint16_t low = (uint16_t)(0xDC00 | (codePoint & 0x3FF));
+                result[out++] = swap ? str_swap16(high) : high;
+                result[out++] = swap ? str_swap16(low) : low;
+            }
+            i += seqLen;
+        }
+    }
+
+    result[out] = 0;
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Transcodes a UTF-8 string to zero-terminated UTF-32 in host byte order
+StrError str_toUTF32(const char* str, uint32_t* result, size_t resultSize) {
+    STR_STATS_SCOPE(STR_FN_TO_UTF32);
+    if (!str || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+    if (resultSize == 0) return (str_last_error = STR_ERROR_BUFFER_TOO_SMALL);
+
+    const unsigned char* bytes = (const unsigned char*)str;
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+
+    size_t capacity = resultSize - 1;
+    size_t i = 0, out = 0;
+    while (i < len) {
+        size_t room = capacity - out;
+        size_t ascii = str_loadKernels()->widenAscii32(str + i, len - i < room ? len - i : room, result + out);
+        i += ascii;
+        out += ascii;
+
+        while (i < len && (bytes[i] >= 0x80 || out == capacity)) {
+            if (out == capacity) return (str_last_error = STR_ERROR_BUFFER_TOO_SMALL);
+
+            uint32_t codePoint;
+            int seqLen = str_decodeSequence(bytes + i, len - i, &codePoint);
+            if (!seqLen) return (str_last_error = STR_ERROR_INVALID_UTF8);
+            result[out++] = codePoint;
+            i += seqLen;
+        }
+    }
+
+    result[out] = 0;
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Returns the number of UTF-8 bytes needed to hold srcLen units of UTF-16
+int str_utf8LengthFromUTF16(const uint16_t* src, size_t srcLen, StrByteOrder order) {
+    if (!src && srcLen) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return -1;
+    }
+
+    bool swap = str_needsSwap(order);
+    size_t bytes = 0;
+    for (size_t i = 0; i < srcLen;) {
+        uint32_t codePoint;
+        int units = str_decodeUTF16(src + i, srcLen - i, swap, &codePoint);
+        if (!units) {
+            str_last_error = STR_ERROR_INVALID_CODE_UNIT;
+            return -1;
+        }
+        bytes += str_encodedLength(codePoint);
+        i += units;
+    }
+
+    str_last_error = STR_SUCCESS;
+    return (int)bytes;
+}
+
+// Transcodes srcLen units of UTF-16 in the given byte order to a UTF-8 string
+StrError str_fromUTF16(const uint16_t* src, size_t srcLen, StrByteOrder order, char* result, size_t resultSize) {
+    STR_STATS_SCOPE(STR_FN_FROM_UTF16);
+    if ((!src && srcLen) || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+    if (resultSize == 0) return (str_last_error = STR_ERROR_BUFFER_TOO_SMALL);
+    STR_STATS_BYTES(srcLen * sizeof(uint16_t));
+
+    bool swap = str_needsSwap(order);
+    size_t capacity = resultSize - 1;
+    size_t i = 0, out = 0;
+    while (i < srcLen) {
+        size_t room = capacity - out;
+        size_t ascii = str_loadKernels()->narrowAscii16(src + i, srcLen - i < room ? srcLen - i : room, result + out, swap);
+        i += ascii;
+        out += ascii;
+
+        while (i < srcLen && ((swap ? str_swap16(src[i]) : src[i]) >= 0x80 || out == capacity)) {
+            uint32_t codePoint;
+            int units = str_decodeUTF16(src + i, srcLen - i, swap, &codePoint);
+            if (!units) return (str_last_error = STR_ERROR_INVALID_CODE_UNIT);
+
+            size_t encodedLen = str_encodedLength(codePoint);
+            if (out + encodedLen > capacity) return (str_last_error = STR_ERROR_BUFFER_TOO_SMALL);
+            str_encodeCodePoint(codePoint, result + out);
+            out += encodedLen;
+            i += units;
+        }
+    }
+
+    result[out] = '\0';
+    return (str_last_error = STR_SUCCESS);
+}
+
+// Returns the number of UTF-8 bytes needed to hold srcLen UTF-32 code points
+int str_utf8LengthFromUTF32(const uint32_t* src, size_t srcLen) {
+    if (!src && srcLen) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return -1;
+    }
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < srcLen; i++) {
+        if (!str_isScalarValue(src[i])) {
+            str_last_error = STR_ERROR_INVALID_CODE_UNIT;
+            return -1;
+        }
+        bytes += str_encodedLength(src[i]);
+    }
+
+    str_last_error = STR_SUCCESS;
+    return (int)bytes;
+}
+
+// Transcodes srcLen UTF-32 code points in host byte order to a UTF-8 string
+StrError str_fromUTF32(const uint32_t* src, size_t srcLen, char* result, size_t resultSize) {
+    STR_STATS_SCOPE(STR_FN_FROM_UTF32);
+    if ((!src && srcLen) || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+    if (resultSize == 0) return (str_last_error = STR_ERROR_BUFFER_TOO_SMALL);
+    STR_STATS_BYTES(srcLen * sizeof(uint32_t));
+
+    size_t capacity = resultSize - 1;
+    size_t i = 0, out = 0;
+    while (i < srcLen) {
+        size_t room = capacity - out;
+        size_t ascii = str_loadKernels()->narrowAscii32(src + i, srcLen - i < room ? srcLen - i : room, result + out);
+        i += ascii;
+        out += ascii;
+
+        while (i < srcLen && (src[i] >= 0x80 || out == capacity)) {
+            if (!str_isScalarValue(src[i])) return (str_last_error = STR_ERROR_INVALID_CODE_UNIT);
+
+            size_t encodedLen = str_encodedLength(src[i]);
+            if (out + encodedLen > capacity) return (str_last_error = STR_ERROR_BUFFER_TOO_SMALL);
+            str_encodeCodePoint(src[i], result + out);
+            out += encodedLen;
+            i++;
+        }
+    }
+
+    result[out] = '\0';
+    return (str_last_error = STR_SUCCESS);
+}
+
+// ==== REGULAR EXPRESSIONS ====
+// Patterns are parsed into a small AST, compiled to a Thompson NFA over UTF-8 bytes and
+// matched with a lazily built DFA, so matching is linear in the input. A forward DFA finds
+// where the leftmost-first match ends and a reverse DFA then walks back to where it starts.
+// Supported: literals, ., [...] classes, \d \w \s (and negations), escapes, (...), (?:...),
+// |, * + ? {n} {n,} {n,m} with lazy variants, and ^ / $ at the ends of the input. Groups
+// do not capture. As in other automaton engines, a loop whose body matched empty keeps
+// trying later iterations instead of stopping, so rare nullable loops can match more than
+// a backtracking engine would.
+
+#define STR_REGEX_MAX_REPEAT 1000
+#define STR_REGEX_MAX_NFA_STATES 100000
+#define STR_REGEX_MAX_PREFIX 64
+#define STR_DFA_MAX_STATES 4096
+#define STR_DFA_UNKNOWN -1
+#define STR_DFA_DEAD 0
+
+typedef enum {
+    STR_RE_EMPTY,
+    STR_RE_RANGES,
+    STR_RE_CONCAT,
+    STR_RE_ALTERNATE,
+    STR_RE_REPEAT,
+    STR_RE_TEXT_START,
+    STR_RE_TEXT_END
+} StrRegexNodeKind;
+
+typedef struct {
+    StrRegexNodeKind kind;
+    int left, right;             // Children of CONCAT / ALTERNATE; left is the REPEAT body
+    int rangeStart, rangeCount;  // Code point ranges of RANGES, as lo/hi pairs
+    int min, max;                // REPEAT bounds; max is -1 when unbounded
+    bool greedy;
+} StrRegexNode;
+
+typedef struct {
+    const unsigned char* pos;
+    const unsigned char* end;
+    StrRegexNode* nodes;
+    int nodeCount, nodeCapacity;
+    uint32_t* ranges;
+    int rangeCount, rangeCapacity;  // Counted in code points, two per range
+    bool failed;
+} StrRegexParser;
+
+typedef enum {
+    STR_NFA_BYTES,          // Consumes one byte in [lo, hi]
+    STR_NFA_SPLIT,          // Epsilon to out, then (lower priority) to out1
+    STR_NFA_MATCH,
+    STR_NFA_ASSERT_BEGIN,   // Passes only where the scan starts at the edge of the text
+    STR_NFA_ASSERT_FINISH   // Passes only once the scan has reached the edge of the text
+} StrNfaKind;
+
+typedef struct {
+    uint8_t kind;
+    uint8_t lo, hi;
+    int out, out1;
+} StrNfaState;
+
+typedef struct {
+    StrNfaState* states;
+    int count, capacity;
+    int start;
+} StrNfa;
+
+typedef struct {
+    int listStart, listLength;  // Ordered NFA states, highest priority first
+    bool isMatch;
+    signed char finishMatch[2]; // Whether the state matches at the edge of the text, indexed by whether
+                                // that edge is also the other one (empty text); -1 until known
+} StrDfaState;
+
+typedef struct {
+    const StrNfa* nfa;
+    const uint8_t* byteClasses;
+    const uint8_t* classBytes;
+    int classCount;
+    bool leftmostFirst;         // Drop lower-priority threads once a match is reached
+    StrDfaState* states;
+    int stateCount, stateCapacity;
+    int* lists;
+    size_t listLength, listCapacity;
+    int* transitions;           // stateCapacity * classCount entries
+    int* table;                 // Open-addressed hash of state indices
+    int tableCapacity;
+    int starts[2];              // Start state when the scan does not / does begin at the text edge
+    int* scratch;
+    int* stack;
+    unsigned* marks;
+    unsigned mark;
+} StrDfa;
+
+struct StrRegex {
+    StrNfa forward;             // Unanchored: a lazy any-byte loop runs ahead of the pattern
+    StrNfa reverse;             // Anchored, with concatenations and byte sequences reversed
+    uint8_t byteClasses[256];
+    uint8_t classBytes[256];
+    int classCount;
+    StrDfa forwardDfa;
+    StrDfa reverseDfa;
+    char prefix[STR_REGEX_MAX_PREFIX];  // Literal every match starts with, used as a prefilter
+    size_t prefixLength;
+};
+
+// ---- Parser ----
+
+static int str_regexNode(StrRegexParser* parser, StrRegexNodeKind kind) {
+    if (parser->nodeCount == parser->nodeCapacity) {
+        int capacity = parser->nodeCapacity ? parser->nodeCapacity * 2 : 32;
+        StrRegexNode* nodes = realloc(parser->nodes, capacity * sizeof(StrRegexNode));
+        if (!nodes) {
+            parser->failed = true;
+            return -1;
+        }
+        parser->nodes = nodes;
+        parser->nodeCapacity = capacity;
+    }
+
+    StrRegexNode* node = &parser->nodes[parser->nodeCount];
+    memset(node, 0, sizeof(*node));
+    node->kind = kind;
+    node->left = node->right = -1;
+    return parser->nodeCount++;
+}
+
+static int str_regexPair(StrRegexParser* parser, StrRegexNodeKind kind, int left, int right) {
+    int index = str_regexNode(parser, kind);
+    if (index < 0) return -1;
+    parser->nodes[index].left = left;
+    parser->nodes[index].right = right;
+    return index;
+}
+
+static bool str_regexAddRange(StrRegexParser* parser, uint32_t lo, uint32_t hi) {
+    if (parser->rangeCount + 2 > parser->rangeCapacity) {
+        int capacity = parser->rangeCapacity ? parser->rangeCapacity * 2 : 64;
+        uint32_t* ranges = realloc(parser->ranges, capacity * sizeof(uint32_t));
+        if (!ranges) {
+            parser->failed = true;
+            return false;
+        }
+        parser->ranges = ranges;
+        parser->rangeCapacity = capacity;
+    }
+    parser->ranges[parser->rangeCount++] = lo;
+    parser->ranges[parser->rangeCount++] = hi;
+    return true;
+}
+
+static int str_compareRanges(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Sorts and merges the ranges added since start, optionally complementing them, and
+// removes the surrogate block, which UTF-8 cannot encode
+static bool str_regexFinishRanges(StrRegexParser* parser, int start, bool negate) {
+    int pairs = (parser->rangeCount - start) / 2;
+    qsort(parser->ranges + start, pairs, 2 * sizeof(uint32_t), str_compareRanges);
+
+    int merged = 0;
+    for (int i = 0; i < pairs; i++) {
+        uint32_t lo = parser->ranges[start + 2 * i], hi = parser->ranges[start + 2 * i + 1];
+        if (merged && lo <= parser->ranges[start + 2 * merged - 1] + 1) {
+            if (hi > parser->ranges[start + 2 * merged - 1]) parser->ranges[start + 2 * merged - 1] = hi;
+        } else {
+            parser->ranges[start + 2 * merged] = lo;
+            parser->ranges[start + 2 * merged + 1] = hi;
+            merged++;
+        }
+    }
+
+    uint32_t* copy = malloc((2 * merged + 2) * sizeof(uint32_t));
+    if (!copy) {
+        parser->failed = true;
+        return false;
+    }
+
+    // Complement into the copy when negating
+    int count = 0;
+    if (negate) {
+        uint32_t next = 0;
+        for (int i = 0; i < merged; i++) {
+            uint32_t lo = parser->ranges[start + 2 * i], hi = parser->ranges[start + 2 * i + 1];
+            if (lo > next) {
+                copy[2 * count] = next;
+                copy[2 * count + 1] = lo - 1;
+                count++;
+            }
+            next = hi + 1;
+        }
+        if (next <= 0x10FFFF) {
+            copy[2 * count] = next;
+            copy[2 * count + 1] = 0x10FFFF;
+            count++;
+        }
+    } else {
+        memcpy(copy, parser->ranges + start, 2 * merged * sizeof(uint32_t));
+        count = merged;
+    }
+
+    parser->rangeCount = start;
+    for (int i = 0; i < count; i++) {
+        uint32_t lo = copy[2 * i], hi = copy[2 * i + 1];
+        if (lo < 0xD800 && hi > 0xDFFF) {
+            if (!str_regexAddRange(parser, lo, 0xD7FF)) break;
+            lo = 0xE000;
+        }
+        if (lo >= 0xD800 && lo <= 0xDFFF) lo = 0xE000;
+        if (hi >= 0xD800 && hi <= 0xDFFF) hi = 0xD7FF;
+        if (lo <= hi && !str_regexAddRange(parser, lo, hi)) break;
+    }
+
+    free(copy);
+    return !parser->failed;
+}
+
+static int str_regexRangesNode(StrRegexParser* parser, int start) {
+    int index = str_regexNode(parser, STR_RE_RANGES);
+    if (index < 0) return -1;
+    parser->nodes[index].rangeStart = start;
+    parser->nodes[index].rangeCount = (parser->rangeCount - start) / 2;
+    return index;
+}
+
+static bool str_regexPeek(const StrRegexParser* parser, char c) {
+    return parser->pos < parser->end && *parser->pos == (unsigned char)c;
+}
+
+static int str_regexHexValue(unsigned char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Reads exactly count hex digits
+static long str_regexHex(StrRegexParser* parser, int count) {
+    long value = 0;
+    for (int i = 0; i < count; i++) {
+        if (parser->pos >= parser->end) return -1;
+        int digit = str_regexHexValue(*parser->pos++);
+        if (digit < 0) return -1;
+        value = value * 16 + digit;
+    }
+    return value;
+}
+
+// Adds the ranges of \d, \w or \s (negated for the upper-case forms)
+static bool str_regexAddShorthand(StrRegexParser* parser, unsigned char c, bool* negated) {
+    int start = parser->rangeCount;
+    unsigned char lower = c | 0x20;
+    *negated = c != lower;
+
+    if (lower == 'd') {
+        str_regexAddRange(parser, '0', '9');
+    } else if (lower == 'w') {
+        str_regexAddRange(parser, '0', '9');
+        str_regexAddRange(parser, 'A', 'Z');
+        str_regexAddRange(parser, '_', '_');
+        str_regexAddRange(parser, 'a', 'z');
+    } else if (lower == 's') {
+        int size = sizeof(unicodeWhitespace) / sizeof(unicodeWhitespace[0]);
+        for (int i = 0; i < size; i++) str_regexAddRange(parser, unicodeWhitespace[i], unicodeWhitespace[i]);
+        str_regexAddRange(parser, 0xFEFF, 0xFEFF);
+    } else {
+        return false;
+    }
+    return parser->rangeCount > start;
+}
+
+// Parses the escape after a backslash into a single code point; returns -1 on error
+static long str_regexEscapeCodePoint(StrRegexParser* parser) {
+    if (parser->pos >= parser->end) return -1;
+    unsigned char c = *parser->pos;
+
+    switch (c) {
+        case 't': parser->pos++; return '\t';
+        case 'n': parser->pos++; return '\n';
+        case 'r': parser->pos++; return '\r';
+        case 'v': parser->pos++; return '\v';
+        case 'f': parser->pos++; return '\f';
+        case '0': parser->pos++; return 0;
+        case 'x': parser->pos++; return str_regexHex(parser, 2);
+        case 'u':
+            parser->pos++;
+            if (str_regexPeek(parser, '{')) {
+                parser->pos++;
+                long value = 0;
+                int digits = 0;
+                while (parser->pos < parser->end && *parser->pos != '}') {
+                    int digit = str_regexHexValue(*parser->pos++);
+                    if (digit < 0 || ++digits > 6) return -1;
+                    value = value * 16 + digit;
+                }
+                if (!digits || !str_regexPeek(parser, '}') || value > 0x10FFFF) return -1;
+                parser->pos++;
+                return value;
+            }
+            return str_regexHex(parser, 4);
+    }
+
+    // Any other ASCII punctuation escapes itself; letters and digits are reserved
+    if (c < 0x80 && !(c >= '0' && c <= '9') && !((c | 0x20) >= 'a' && (c | 0x20) <= 'z')) {
+        parser->pos++;
+        return c;
+    }
+    return -1;
+}
+
+// Reads one literal code point from the pattern
+static long str_regexCodePoint(StrRegexParser* parser) {
+    uint32_t codePoint;
+    int seqLen = str_decodeSequence(parser->pos, parser->end - parser->pos, &codePoint);
+    if (!seqLen) return -1;
+    parser->pos += seqLen;
+    return codePoint;
+}
+
+static int str_regexParseClass(StrRegexParser* parser) {
+    int start = parser->rangeCount;
+    bool negate = false;
+    if (str_regexPeek(parser, '^')) {
+        negate = true;
+        parser->pos++;
+    }
+
+    bool first = true;
+    while (parser->pos < parser->end && (!str_regexPeek(parser, ']') || first)) {
+        first = false;
+        long lo;
+
+        if (str_regexPeek(parser, '\\')) {
+            parser->pos++;
+            if (parser->pos < parser->end && strchr("dDwWsS", *parser->pos)) {
+                bool negated;
+                int shorthandStart = parser->rangeCount;
+                str_regexAddShorthand(parser, *parser->pos++, &negated);
+                if (negated && !str_regexFinishRanges(parser, shorthandStart, true)) return -1;
+                continue;
+            }
+            lo = parser->pos < parser->end && *parser->pos == 'b' ? (parser->pos++, '\b') : str_regexEscapeCodePoint(parser);
+        } else {
+            lo = str_regexCodePoint(parser);
+        }
+        if (lo < 0) return -1;
+
+        long hi = lo;
+        if (str_regexPeek(parser, '-') && parser->pos + 1 < parser->end && parser->pos[1] != ']') {
+            parser->pos++;
+            if (str_regexPeek(parser, '\\')) {
+                parser->pos++;
+                hi = str_regexEscapeCodePoint(parser);
+            } else {
+                hi = str_regexCodePoint(parser);
+            }
+            if (hi < lo) return -1;
+        }
+        if (!str_regexAddRange(parser, (uint32_t)lo, (uint32_t)hi)) return -1;
+    }
+
+    if (!str_regexPeek(parser, ']')) return -1;
+    parser->pos++;
+
+    if (!str_regexFinishRanges(parser, start, negate)) return -1;
+    return str_regexRangesNode(parser, start);
+}
+
+static int str_regexParseAlternation(StrRegexParser* parser, int depth);
+
+static int str_regexParseAtom(StrRegexParser* parser, int depth) {
+    unsigned char c = *parser->pos;
+    int start = parser->rangeCount;
+
+    switch (c) {
+        case '(': {
+            parser->pos++;
+            if (str_regexPeek(parser, '?')) {
+                if (parser->pos + 1 >= parser->end || parser->pos[1] != ':') return -1;
+                parser->pos += 2;
+            }
+            int inner = str_regexParseAlternation(parser, depth + 1);
+            if (inner < 0 || !str_regexPeek(parser, ')')) return -1;
+            parser->pos++;
+            return inner;
+        }
+        case '[':
+            parser->pos++;
+            return str_regexParseClass(parser);
+        case '.':
+            // Any code point except the line terminators
+            parser->pos++;
+            str_regexAddRange(parser, '\n', '\n');
+            str_regexAddRange(parser, '\r', '\r');
+            str_regexAddRange(parser, 0x2028, 0x2029);
+            if (!str_regexFinishRanges(parser, start, true)) return -1;
+            return str_regexRangesNode(parser, start);
+        case '^':
+            parser->pos++;
+            return str_regexNode(parser, STR_RE_TEXT_START);
+        case '$':
+            parser->pos++;
+            return str_regexNode(parser, STR_RE_TEXT_END);
+        case '\\': {
+            parser->pos++;
+            if (parser->pos < parser->end && strchr("dDwWsS", *parser->pos)) {
+                bool negated;
+                str_regexAddShorthand(parser, *parser->pos++, &negated);
+                if (!str_regexFinishRanges(parser, start, negated)) return -1;
+                return str_regexRangesNode(parser, start);
+            }
+            long codePoint = str_regexEscapeCodePoint(parser);
+            if (codePoint < 0 || !str_regexAddRange(parser, codePoint, codePoint)) return -1;
+            if (!str_regexFinishRanges(parser, start, false)) return -1;
+            return str_regexRangesNode(parser, start);
+        }
+        case '*': case '+': case '?': case ')': case ']': case '{': case '}':
+            return -1;  // Nothing to repeat, or an unbalanced bracket
+    }
+
+    long codePoint = str_regexCodePoint(parser);
+    if (codePoint < 0 || !str_regexAddRange(parser, codePoint, codePoint)) return -1;
+    if (!str_regexFinishRanges(parser, start, false)) return -1;
+    return str_regexRangesNode(parser, start);
+}
+
+// Reads a decimal repeat bound
+static int str_regexNumber(StrRegexParser* parser) {
+    int value = -1;
+    while (parser->pos < parser->end && *parser->pos >= '0' && *parser->pos <= '9') {
+        value = (value < 0 ? 0 : value) * 10 + (*parser->pos++ - '0');
+        if (value > STR_REGEX_MAX_REPEAT) return -2;
+    }
+    return value;
+}
+
+static int str_regexParseRepeat(StrRegexParser* parser, int depth) {
+    bool anchor = *parser->pos == '^' || *parser->pos == '$';
+    int atom = str_regexParseAtom(parser, depth);
+    if (atom < 0 || parser->pos >= parser->end) return atom;
+
+    int min, max;
+    switch (*parser->pos) {
+        case '*': min = 0; max = -1; parser->pos++; break;
+        case '+': min = 1; max = -1; parser->pos++; break;
+        case '?': min = 0; max = 1; parser->pos++; break;
+        case '{':
+            parser->pos++;
+            min = str_regexNumber(parser);
+            max = min;
+            if (str_regexPeek(parser, ',')) {
+                parser->pos++;
+                max = str_regexNumber(parser);
+            }
+            if (min < 0 || max == -2 || !str_regexPeek(parser, '}') || (max >= 0 && max < min)) return -1;
+            parser->pos++;
+            break;
+        default:
+            return atom;
+    }
+
+    // A bare anchor cannot be repeated, though a group holding one can
+    if (anchor) return -1;
+
+    int repeat = str_regexNode(parser, STR_RE_REPEAT);
+    if (repeat < 0) return -1;
+    parser->nodes[repeat].left = atom;
+    parser->nodes[repeat].min = min;
+    parser->nodes[repeat].max = max;
+    parser->nodes[repeat].greedy = true;
+    if (str_regexPeek(parser, '?')) {
+        parser->nodes[repeat].greedy = false;
+        parser->pos++;
+    }
+
+    // A second quantifier (a** or a+*) has nothing to repeat
+    if (parser->pos < parser->end && strchr("*+?{", *parser->pos)) return -1;
+    return repeat;
+}
+
+static int str_regexParseConcat(StrRegexParser* parser, int depth) {
+    int result = -1;
+    while (parser->pos < parser->end && *parser->pos != '|' && *parser->pos != ')') {
+        int item = str_regexParseRepeat(parser, depth);
+        if (item < 0) return -2;
+        result = result < 0 ? item : str_regexPair(parser, STR_RE_CONCAT, result, item);
+        if (result < 0) return -2;
+    }
+    return result < 0 ? str_regexNode(parser, STR_RE_EMPTY) : result;
+}
+
+static int str_regexParseAlternation(StrRegexParser* parser, int depth) {
+    if (depth > 200) return -1;
+
+    int result = str_regexParseConcat(parser, depth);
+    while (result >= 0 && str_regexPeek(parser, '|')) {
+        parser->pos++;
+        int right = str_regexParseConcat(parser, depth);
+        if (right < 0) return -1;
+        result = str_regexPair(parser, STR_RE_ALTERNATE, result, right);
+    }
+    return result < 0 ? -1 : result;
+}
+
+// ---- NFA compilation ----
+
+static int str_nfaAdd(StrNfa* nfa, StrNfaKind kind, int lo, int hi, int out, int out1) {
+    if (nfa->count == nfa->capacity) {
+        if (nfa->count >= STR_REGEX_MAX_NFA_STATES) return -1;
+        int capacity = nfa->capacity ? nfa->capacity * 2 : 64;
+        StrNfaState* states = realloc(nfa->states, capacity * sizeof(StrNfaState));
+        if (!states) return -1;
+        nfa->states = states;
+        nfa->capacity = capacity;
+    }
+
+    StrNfaState* state = &nfa->states[nfa->count];
+    state->kind = kind;
+    state->lo = (uint8_t)lo;
+    state->hi = (uint8_t)hi;
+    state->out = out;
+    state->out1 = out1;
+    return nfa->count++;
+}
+
+// Compiles a chain of byte ranges (reversed for the reverse NFA) in front of next
+static int str_nfaByteSequence(StrNfa* nfa, const uint8_t* lo, const uint8_t* hi, int length, bool reverse, int next) {
+    for (int i = 0; i < length && next >= 0; i++) {
+        int k = reverse ? i : length - 1 - i;
+        next = str_nfaAdd(nfa, STR_NFA_BYTES, lo[k], hi[k], next, -1);
+    }
+    return next;
+}
+
+// Splits a code point range into ranges whose UTF-8 encodings differ only in a
+// per-byte range (the classic utf8-ranges construction) and compiles each one
+static int str_nfaCodePointRange(StrNfa* nfa, uint32_t lo, uint32_t hi, bool reverse, int next, int alternatives) {
+    static const uint32_t limits[] = { 0x7F, 0x7FF, 0xFFFF, 0x10FFFF };
+    for (int n = 0; n < 3; n++) {
+        if (lo <= limits[n] && hi > limits[n]) {
+            alternatives = str_nfaCodePointRange(nfa, lo, limits[n], reverse, next, alternatives);
+            if (alternatives < 0) return -1;
+            return str_nfaCodePointRange(nfa, limits[n] + 1, hi, reverse, next, alternatives);
+        }
+    }
+
+    int length = (int)str_encodedLength(lo);
+    for (int i = 1; i < length; i++) {
+        uint32_t mask = (1u << (6 * i)) - 1;
+        if ((lo & ~mask) != (hi & ~mask)) {
+            if ((lo & mask) != 0) {
+                alternatives = str_nfaCodePointRange(nfa, lo, lo | mask, reverse, next, alternatives);
+                if (alternatives < 0) return -1;
+                return str_nfaCodePointRange(nfa, (lo | mask) + 1, hi, reverse, next, alternatives);
+            }
+            if ((hi & mask) != mask) {
+                alternatives = str_nfaCodePointRange(nfa, lo, (hi & ~mask) - 1, reverse, next, alternatives);
+                if (alternatives < 0) return -1;
+                return str_nfaCodePointRange(nfa, hi & ~mask, hi, reverse, next, alternatives);
+            }
+        }
+    }
+
+    char loBytes[4], hiBytes[4];
+    str_encodeCodePoint(lo, loBytes);
+    str_encodeCodePoint(hi, hiBytes);
+    int sequence = str_nfaByteSequence(nfa, (const uint8_t*)loBytes, (const uint8_t*)hiBytes, length, reverse, next);
+    if (sequence < 0) return -1;
+
+    // Character class alternatives are disjoint, so their priority order does not matter
+    return alternatives < 0 ? sequence : str_nfaAdd(nfa, STR_NFA_SPLIT, 0, 0, alternatives, sequence);
+}
+
+// Compiles node so that it continues to next; returns its entry state
+static int str_nfaCompile(StrNfa* nfa, const StrRegexParser* parser, int index, bool reverse, int next) {
+    const StrRegexNode* node = &parser->nodes[index];
+    if (next < 0) return -1;
+
+    switch (node->kind) {
+        case STR_RE_EMPTY:
+            return next;
+        case STR_RE_RANGES: {
+            int entry = -1;
+            for (int i = 0; i < node->rangeCount; i++) {
+                uint32_t lo = parser->ranges[node->rangeStart + 2 * i];
+                uint32_t hi = parser->ranges[node->rangeStart + 2 * i + 1];
+                int alternatives = str_nfaCodePointRange(nfa, lo, hi, reverse, next, entry);
+                if (alternatives < 0) return -1;
+                entry = alternatives;
+            }
+            // An empty class (such as [^\s\S]) can never match
+            return entry >= 0 ? entry : str_nfaAdd(nfa, STR_NFA_BYTES, 1, 0, next, -1);
+        }
+        case STR_RE_CONCAT:
+            if (reverse) {
+                return str_nfaCompile(nfa, parser, node->right, reverse,
+                                      str_nfaCompile(nfa, parser, node->left, reverse, next));
+            }
+            return str_nfaCompile(nfa, parser, node->left, reverse,
+                                  str_nfaCompile(nfa, parser, node->right, reverse, next));
+        case STR_RE_ALTERNATE: {
+            int left = str_nfaCompile(nfa, parser, node->left, reverse, next);
+            int right = str_nfaCompile(nfa, parser, node->right, reverse, next);
+            if (left < 0 || right < 0) return -1;
+            return str_nfaAdd(nfa, STR_NFA_SPLIT, 0, 0, left, right);
+        }
+        case STR_RE_TEXT_START:
+            return str_nfaAdd(nfa, reverse ? STR_NFA_ASSERT_FINISH : STR_NFA_ASSERT_BEGIN, 0, 0, next, -1);
+        case STR_RE_TEXT_END:
+            return str_nfaAdd(nfa, reverse ? STR_NFA_ASSERT_BEGIN : STR_NFA_ASSERT_FINISH, 0, 0, next, -1);
+        case STR_RE_REPEAT:
+            break;
+    }
+
+    // Built back to front: the optional copies first, then the mandatory ones
+    int current = next;
+    if (node->max < 0) {
+        int loop = str_nfaAdd(nfa, STR_NFA_SPLIT, 0, 0, -1, -1);
+        if (loop < 0) return -1;
+        int body = str_nfaCompile(nfa, parser, node->left, reverse, loop);
+        if (body < 0) return -1;
+        nfa->states[loop].out = node->greedy ? body : next;
+        nfa->states[loop].out1 = node->greedy ? next : body;
+        current = loop;
+    } else {
+        for (int i = node->min; i < node->max; i++) {
+            int body = str_nfaCompile(nfa, parser, node->left, reverse, current);
+            if (body < 0) return -1;
+            current = node->greedy ? str_nfaAdd(nfa, STR_NFA_SPLIT, 0, 0, body, next)
+                                   : str_nfaAdd(nfa, STR_NFA_SPLIT, 0, 0, next, body);
+            if (current < 0) return -1;
+        }
+    }
+    for (int i = 0; i < node->min; i++) {
+        current = str_nfaCompile(nfa, parser, node->left, reverse, current);
+        if (current < 0) return -1;
+    }
+    return current;
+}
+
+// Collects the literal bytes every match must start with; returns true if node was fully literal
+static bool str_regexCollectPrefix(const StrRegexParser* parser, int index, char* prefix, size_t* length) {
+    const StrRegexNode* node = &parser->nodes[index];
+
+    switch (node->kind) {
+        case STR_RE_RANGES: {
+            uint32_t lo = parser->ranges[node->rangeStart];
+            if (node->rangeCount != 1 || lo != parser->ranges[node->rangeStart + 1]) return false;
+            if (*length + str_encodedLength(lo) > STR_REGEX_MAX_PREFIX) return false;
+            *length = str_encodeCodePoint(lo, prefix + *length) - prefix;
+            return true;
+        }
+        case STR_RE_CONCAT:
+            return str_regexCollectPrefix(parser, node->left, prefix, length) &&
+                   str_regexCollectPrefix(parser, node->right, prefix, length);
+        case STR_RE_REPEAT:
+            if (node->min > 0) str_regexCollectPrefix(parser, node->left, prefix, length);
+            return false;
+        case STR_RE_EMPTY:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Splits the byte values into classes that every NFA byte range treats alike
+static void str_regexByteClasses(StrRegex* regex) {
+    bool boundary[257] = { false };
+    for (int i = 0; i < regex->forward.count; i++) {
+        const StrNfaState* state = &regex->forward.states[i];
+        if (state->kind != STR_NFA_BYTES || state->lo > state->hi) continue;
+        boundary[state->lo] = true;
+        boundary[state->hi + 1] = true;
+    }
+
+    int cls = 0;
+    for (int b = 0; b < 256; b++) {
+        if (b > 0 && boundary[b]) cls++;
+        regex->byteClasses[b] = (uint8_t)cls;
+        regex->classBytes[cls] = (uint8_t)b;
+    }
+    regex->classCount = cls + 1;
+}
+
+// ---- Lazy DFA ----
+
+static void str_dfaFree(StrDfa* dfa) {
+    free(dfa->states);
+    free(dfa->lists);
+    free(dfa->transitions);
+    free(dfa->table);
+    free(dfa->scratch);
+    free(dfa->stack);
+    free(dfa->marks);
+    memset(dfa, 0, sizeof(*dfa));
+}
+
+// Forgets every cached state and re-creates the dead state at index 0
+static void str_dfaClear(StrDfa* dfa) {
+    dfa->stateCount = 0;
+    dfa->listLength = 0;
+    for (int i = 0; i < dfa->tableCapacity; i++) dfa->table[i] = -1;
+    dfa->starts[0] = dfa->starts[1] = -1;
+
+    StrDfaState* dead = &dfa->states[dfa->stateCount++];
+    dead->listStart = 0;
+    dead->listLength = 0;
+    dead->isMatch = false;
+    dead->finishMatch[0] = dead->finishMatch[1] = 0;
+    for (int c = 0; c < dfa->classCount; c++) dfa->transitions[c] = STR_DFA_DEAD;
+}
+
+static bool str_dfaInit(StrDfa* dfa, const StrNfa* nfa, const StrRegex* regex, bool leftmostFirst) {
+    memset(dfa, 0, sizeof(*dfa));
+    dfa->nfa = nfa;
+    dfa->byteClasses = regex->byteClasses;
+    dfa->classBytes = regex->classBytes;
+    dfa->classCount = regex->classCount;
+    dfa->leftmostFirst = leftmostFirst;
+
+    dfa->stateCapacity = 64;
+    dfa->tableCapacity = 2 * STR_DFA_MAX_STATES;
+    dfa->states = malloc(dfa->stateCapacity * sizeof(StrDfaState));
+    dfa->transitions = malloc((size_t)dfa->stateCapacity * dfa->classCount * sizeof(int));
+    dfa->table = malloc(dfa->tableCapacity * sizeof(int));
+    dfa->scratch = malloc(nfa->count * sizeof(int));
+    dfa->stack = malloc((2 * nfa->count + 1) * sizeof(int));
+    dfa->marks = calloc(nfa->count, sizeof(unsigned));
+    if (!dfa->states || !dfa->transitions || !dfa->table || !dfa->scratch || !dfa->stack || !dfa->marks) {
+        str_dfaFree(dfa);
+        return false;
+    }
+
+    str_dfaClear(dfa);
+    return true;
+}
+
+static unsigned str_dfaHash(const int* list, int length) {
+    unsigned hash = 2166136261u;
+    for (int i = 0; i < length; i++) hash = (hash ^ (unsigned)list[i]) * 16777619u;
+    return hash;
+}
+
+// Returns the state for an ordered NFA state list, adding it if needed. Returns -1 when
+// out of memory and -2 when the cache is full and must be cleared first.
+static int str_dfaIntern(StrDfa* dfa, const int* list, int length, bool isMatch) {
+    if (length == 0) return STR_DFA_DEAD;
+
+    unsigned slot = str_dfaHash(list, length) & (dfa->tableCapacity - 1);
+    while (dfa->table[slot] >= 0) {
+        const StrDfaState* state = &dfa->states[dfa->table[slot]];
+        if (state->listLength == length && state->isMatch == isMatch &&
+            memcmp(dfa->lists + state->listStart, list, length * sizeof(int)) == 0) {
+            return dfa->table[slot];
+        }
+        slot = (slot + 1) & (dfa->tableCapacity - 1);
+    }
+
+    if (dfa->stateCount >= STR_DFA_MAX_STATES) return -2;
+
+    if (dfa->stateCount == dfa->stateCapacity) {
+        int capacity = dfa->stateCapacity * 2;
+        StrDfaState* states = realloc(dfa->states, capacity * sizeof(StrDfaState));
+        if (!states) return -1;
+        dfa->states = states;
+        int* transitions = realloc(dfa->transitions, (size_t)capacity * dfa->classCount * sizeof(int));
+        if (!transitions) return -1;
+        dfa->transitions = transitions;
+        dfa->stateCapacity = capacity;
+    }
+    if (dfa->listLength + length > dfa->listCapacity) {
+        size_t capacity = dfa->listCapacity ? dfa->listCapacity * 2 : 256;
+        while (capacity < dfa->listLength + length) capacity *= 2;
+        int* lists = realloc(dfa->lists, capacity * sizeof(int));
+        if (!lists) return -1;
+        dfa->lists = lists;
+        dfa->listCapacity = capacity;
+    }
+
+    int index = dfa->stateCount++;
+    StrDfaState* state = &dfa->states[index];
+    state->listStart = (int)dfa->listLength;
+    state->listLength = length;
+    state->isMatch = isMatch;
+    state->finishMatch[0] = state->finishMatch[1] = -1;
+    memcpy(dfa->lists + dfa->listLength, list, length * sizeof(int));
+    dfa->listLength += length;
+
+    int* row = dfa->transitions + (size_t)index * dfa->classCount;
+    for (int c = 0; c < dfa->classCount; c++) row[c] = STR_DFA_UNKNOWN;
 
-    while (*suffix) {
-        if (*str++ != *suffix++) return 0;
+    dfa->table[slot] = index;
+    return index;
+}
+
+// Appends the epsilon closure of root to list in priority order. Assertions pass when
+// their condition holds; unresolved FINISH assertions stay in the list. Returns true
+// once a match has cut off the remaining lower-priority threads.
+static bool str_dfaClosure(StrDfa* dfa, int root, bool begin, bool finish, int* list, int* length, bool* isMatch) {
+    const StrNfaState* states = dfa->nfa->states;
+    int top = 0;
+    dfa->stack[top++] = root;
+
+    while (top > 0) {
+        int index = dfa->stack[--top];
+        if (index < 0 || dfa->marks[index] == dfa->mark) continue;
+        dfa->marks[index] = dfa->mark;
+
+        const StrNfaState* state = &states[index];
+        switch (state->kind) {
+            case STR_NFA_SPLIT:
+                dfa->stack[top++] = state->out1;
+                dfa->stack[top++] = state->out;
+                break;
+            case STR_NFA_ASSERT_BEGIN:
+                if (begin) dfa->stack[top++] = state->out;
+                break;
+            case STR_NFA_ASSERT_FINISH:
+                if (finish) dfa->stack[top++] = state->out;
+                else list[(*length)++] = index;
+                break;
+            case STR_NFA_MATCH:
+                list[(*length)++] = index;
+                *isMatch = true;
+                if (dfa->leftmostFirst) return true;
+                break;
+            default:
+                list[(*length)++] = index;
+                break;
+        }
     }
+    return false;
+}
 
-    return 1;
+// Re-interns a list after clearing a full cache
+static int str_dfaInternOrClear(StrDfa* dfa, const int* list, int length, bool isMatch) {
+    int index = str_dfaIntern(dfa, list, length, isMatch);
+    if (index != -2) return index;
+    str_dfaClear(dfa);
+    return str_dfaIntern(dfa, list, length, isMatch);
 }
 
-// Check if a string includes a given substring
-int str_includes(const char* str, const char* substr) {
-    if (!str || !substr) {
-        str_last_error = STR_ERROR_NULL_INPUT;
-        return 0;
+static int str_dfaStart(StrDfa* dfa, bool atEdge) {
+    if (dfa->starts[atEdge] >= 0) return dfa->starts[atEdge];
+
+    int length = 0;
+    bool isMatch = false;
+    dfa->mark++;
+    str_dfaClosure(dfa, dfa->nfa->start, atEdge, false, dfa->scratch, &length, &isMatch);
+
+    int index = str_dfaInternOrClear(dfa, dfa->scratch, length, isMatch);
+    if (index >= 0) dfa->starts[atEdge] = index;
+    return index;
+}
+
+// Computes and caches the transition of a state on a byte
+static int str_dfaStep(StrDfa* dfa, int from, unsigned char byte) {
+    int cls = dfa->byteClasses[byte];
+    int cached = dfa->transitions[(size_t)from * dfa->classCount + cls];
+    if (cached != STR_DFA_UNKNOWN) return cached;
+
+    const StrDfaState* state = &dfa->states[from];
+    const int* list = dfa->lists + state->listStart;
+    int length = 0;
+    bool isMatch = false;
+    dfa->mark++;
+
+    for (int i = 0; i < state->listLength; i++) {
+        const StrNfaState* nfaState = &dfa->nfa->states[list[i]];
+        if (nfaState->kind != STR_NFA_BYTES || byte < nfaState->lo || byte > nfaState->hi) continue;
+        if (str_dfaClosure(dfa, nfaState->out, false, false, dfa->scratch, &length, &isMatch)) break;
     }
 
-    return str_indexOf(str, substr) != -1;
+    int index = str_dfaIntern(dfa, dfa->scratch, length, isMatch);
+    if (index == -2) {
+        // The source state is gone after clearing, so the transition is not cached
+        str_dfaClear(dfa);
+        return str_dfaIntern(dfa, dfa->scratch, length, isMatch);
+    }
+    if (index >= 0) dfa->transitions[(size_t)from * dfa->classCount + cls] = index;
+    return index;
 }
 
-// Extracts a substring from a string and stores it in result
-void str_slice(const char* str, int start, int end, char* result) {
-    if (!str || !result) {
+// Checks whether a state matches once the pending FINISH assertions are satisfied. In an empty
+// text the far edge is also the near one, so BEGIN assertions reached from them pass as well.
+static bool str_dfaFinishMatch(StrDfa* dfa, int index, bool begin) {
+    StrDfaState* state = &dfa->states[index];
+    if (state->isMatch) return true;
+    if (state->finishMatch[begin] >= 0) return state->finishMatch[begin];
+
+    bool isMatch = false;
+    int length = 0;
+    dfa->mark++;
+    const int* list = dfa->lists + state->listStart;
+    for (int i = 0; i < state->listLength && !isMatch; i++) {
+        const StrNfaState* nfaState = &dfa->nfa->states[list[i]];
+        if (nfaState->kind != STR_NFA_ASSERT_FINISH) continue;
+        str_dfaClosure(dfa, nfaState->out, begin, true, dfa->scratch, &length, &isMatch);
+    }
+
+    state->finishMatch[begin] = isMatch;
+    return isMatch;
+}
+
+// Finds the end of the leftmost-first match starting at or after from.
+// Returns the end offset, -1 if there is no match, or -2 when out of memory.
+static long str_regexForward(StrRegex* regex, const char* text, size_t len, size_t from) {
+    StrDfa* dfa = &regex->forwardDfa;
+    const unsigned char* bytes = (const unsigned char*)text;
+
+    if (regex->prefixLength && str_dfaStart(dfa, false) < 0) return -2;
+    int state = str_dfaStart(dfa, from == 0);
+    if (state < 0) return -2;
+
+    long end = dfa->states[state].isMatch ? (long)from : -1;
+    size_t i = from;
+    while (i < len) {
+        // With no thread in flight, jump straight to the next occurrence of the literal prefix
+        if (regex->prefixLength && state == dfa->starts[0]) {
+            const char* hit = str_loadKernels()->find(text + i, len - i, regex->prefix, regex->prefixLength);
+            if (!hit) return end;
+            i = hit - text;
+        }
+
+        state = str_dfaStep(dfa, state, bytes[i++]);
+        if (state < 0) return -2;
+        if (state == STR_DFA_DEAD) return end;
+        if (dfa->states[state].isMatch) end = (long)i;
+
+        // A full cache is flushed along with the start states; re-seed so the prefilter keeps working
+        if (regex->prefixLength && dfa->starts[0] < 0 && str_dfaStart(dfa, false) < 0) return -2;
+    }
+
+    if (str_dfaFinishMatch(dfa, state, len == 0)) end = (long)len;
+    return end;
+}
+
+// Walks back from the end of a match to the leftmost offset (not before from) where it can start
+static long str_regexReverse(StrRegex* regex, const char* text, size_t len, size_t from, size_t end) {
+    StrDfa* dfa = &regex->reverseDfa;
+    const unsigned char* bytes = (const unsigned char*)text;
+
+    int state = str_dfaStart(dfa, end == len);
+    if (state < 0) return -2;
+
+    long start = dfa->states[state].isMatch ? (long)end : -1;
+    size_t i = end;
+    while (i > from) {
+        state = str_dfaStep(dfa, state, bytes[--i]);
+        if (state < 0) return -2;
+        if (state == STR_DFA_DEAD) return start;
+        if (dfa->states[state].isMatch) start = (long)i;
+    }
+
+    if (from == 0 && str_dfaFinishMatch(dfa, state, len == 0)) start = 0;
+    return start;
+}
+
+// Finds the byte span of the first match at or after from; returns false if there is none
+static bool str_regexFind(StrRegex* regex, const char* text, size_t len, size_t from, size_t* start, size_t* end) {
+    long matchEnd = str_regexForward(regex, text, len, from);
+    if (matchEnd < 0) {
+        str_last_error = matchEnd == -2 ? STR_ERROR_MEMORY_ALLOCATION : STR_SUCCESS;
+        return false;
+    }
+
+    long matchStart = str_regexReverse(regex, text, len, from, (size_t)matchEnd);
+    if (matchStart < 0) {
+        str_last_error = matchStart == -2 ? STR_ERROR_MEMORY_ALLOCATION : STR_SUCCESS;
+        return false;
+    }
+
+    *start = (size_t)matchStart;
+    *end = (size_t)matchEnd;
+    str_last_error = STR_SUCCESS;
+    return true;
+}
+
+// ---- Public API ----
+
+// Compiles a pattern; returns NULL and sets str_last_error if it is invalid
+StrRegex* str_regexCompile(const char* pattern) {
+    if (!pattern) {
         str_last_error = STR_ERROR_NULL_INPUT;
-        return;
+        return NULL;
     }
 
-    int i = 0;
-    while (*str && i < start) {
-        str_getUTF8CodePoint(&str);
-        i++;
+    StrRegexParser parser = { 0 };
+    parser.pos = (const unsigned char*)pattern;
+    parser.end = parser.pos + strlen(pattern);
+
+    StrRegex* regex = calloc(1, sizeof(StrRegex));
+    if (!regex) {
+        str_last_error = STR_ERROR_MEMORY_ALLOCATION;
+        return NULL;
     }
 
-    while (*str && i < end) {
-        int seqLen = str_getUTF8SequenceLength((unsigned char)*str);
-        strncpy(result, str, seqLen);
-        result += seqLen;
-        str += seqLen;
-        i++;
+    int root = str_regexParseAlternation(&parser, 0);
+    StrError error = STR_SUCCESS;
+    if (parser.failed) error = STR_ERROR_MEMORY_ALLOCATION;
+    else if (root < 0 || parser.pos != parser.end) error = STR_ERROR_INVALID_PATTERN;
+
+    if (error == STR_SUCCESS) {
+        // Forward: lazy any-byte loop, then the pattern. Reverse: the pattern read backwards.
+        int match = str_nfaAdd(&regex->forward, STR_NFA_MATCH, 0, 0, -1, -1);
+        int anchored = str_nfaCompile(&regex->forward, &parser, root, false, match);
+        int loop = str_nfaAdd(&regex->forward, STR_NFA_SPLIT, 0, 0, anchored, -1);
+        int anyByte = str_nfaAdd(&regex->forward, STR_NFA_BYTES, 0x00, 0xFF, loop, -1);
+        if (loop >= 0 && anyByte >= 0) regex->forward.states[loop].out1 = anyByte;
+        regex->forward.start = loop;
+
+        int reverseMatch = str_nfaAdd(&regex->reverse, STR_NFA_MATCH, 0, 0, -1, -1);
+        regex->reverse.start = str_nfaCompile(&regex->reverse, &parser, root, true, reverseMatch);
+
+        if (anchored < 0 || anyByte < 0 || regex->reverse.start < 0) error = STR_ERROR_INVALID_PATTERN;
     }
 
-    *result = '\0';
+    if (error == STR_SUCCESS) {
+        str_regexCollectPrefix(&parser, root, regex->prefix, &regex->prefixLength);
+        str_regexByteClasses(regex);
+        if (!str_dfaInit(&regex->forwardDfa, &regex->forward, regex, true) ||
+            !str_dfaInit(&regex->reverseDfa, &regex->reverse, regex, false)) {
+            error = STR_ERROR_MEMORY_ALLOCATION;
+        }
+    }
+
+    free(parser.nodes);
+    free(parser.ranges);
+    if (error != STR_SUCCESS) {
+        str_regexFree(regex);
+        str_last_error = error;
+        return NULL;
+    }
+
+    str_last_error = STR_SUCCESS;
+    return regex;
 }
 
-// Extracts a substring from a string and stores it in result
-StrError str_substring(const char* str, int start, int end, char* result) {
-    if (!str || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+// Frees a compiled pattern
+void str_regexFree(StrRegex* regex) {
+    if (!regex) return;
+    str_dfaFree(&regex->forwardDfa);
+    str_dfaFree(&regex->reverseDfa);
+    free(regex->forward.states);
+    free(regex->reverse.states);
+    free(regex);
+}
 
-    int i = 0;
-    const char* startPtr = str;
-    
-    while (*str && i < start) {
-        str_getUTF8CodePoint(&str);
-        i++;
+// Returns the code point index of the first match, or -1 if there is none
+int str_search(StrRegex* regex, const char* str) {
+    STR_STATS_SCOPE(STR_FN_SEARCH);
+    if (!regex || !str) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return -1;
     }
 
-    startPtr = str;
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+
+    size_t start, end;
+    if (!str_regexFind(regex, str, len, 0, &start, &end)) return -1;
+    return str_countCodePoints(str, start);
+}
 
-    while (*str && i < end) {
-        str_getUTF8CodePoint(&str);
-        i++;
+// Finds the first match and stores its code point and byte span
+bool str_match(StrRegex* regex, const char* str, StrMatch* match) {
+    STR_STATS_SCOPE(STR_FN_MATCH);
+    if (!regex || !str || !match) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return false;
     }
 
-    str_copyRange(startPtr, 0, str - startPtr, result);
-    return (str_last_error = STR_SUCCESS);
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+
+    size_t start, end;
+    if (!str_regexFind(regex, str, len, 0, &start, &end)) return false;
+
+    match->byteStart = (int)start;
+    match->byteEnd = (int)end;
+    match->start = str_countCodePoints(str, start);
+    match->end = match->start + str_countCodePoints(str + start, end - start);
+    return true;
 }
 
+// Stores up to maxMatches successive non-overlapping matches; returns how many there are in total
+int str_matchAll(StrRegex* regex, const char* str, StrMatch* matches, int maxMatches) {
+    STR_STATS_SCOPE(STR_FN_MATCH_ALL);
+    if (!regex || !str || (!matches && maxMatches > 0)) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return -1;
+    }
 
-// Pads a string with a given character at the start to reach a target length
-StrError str_padStart(const char* str, int targetLength, const char* padStr, char* result, size_t resultSize) {
-    if (!str || !padStr || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+    const unsigned char* bytes = (const unsigned char*)str;
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+
+    // Code point indices are tracked incrementally from the previous match
+    size_t from = 0, counted = 0;
+    int index = 0, count = 0;
+    size_t start, end;
+    while (from <= len && str_regexFind(regex, str, len, from, &start, &end)) {
+        index += str_countCodePoints(str + counted, start - counted);
+        int matchLength = str_countCodePoints(str + start, end - start);
+        counted = start;
+
+        if (count < maxMatches) {
+            matches[count].start = index;
+            matches[count].end = index + matchLength;
+            matches[count].byteStart = (int)start;
+            matches[count].byteEnd = (int)end;
+        }
+        count++;
+
+        // An empty match steps over one code point so the scan always advances
+        from = end;
+        if (end == start) {
+            if (end >= len) break;
+            int seqLen = str_decodeSequence(bytes + end, len - end, NULL);
+            from += seqLen ? seqLen : 1;
+        }
+    }
 
-    int strLen = str_length(str);
-    int padLen = str_length(padStr);
-    if (targetLength <= strLen || targetLength >= resultSize) return (str_last_error = STR_ERROR_INVALID_INDEX);
+    return str_last_error == STR_SUCCESS ? count : -1;
+}
 
-    char temp[resultSize];
-    temp[0] = '\0';
+// ==== CASE-INSENSITIVE SEARCH ====
+// Matching compares simple case folds (CaseFolding.txt C + S) code point by code point, so
+// neither string is copied. ASCII needles take the vectorized findFold kernel; others fold
+// both sides on the fly.
+
+// Applies Unicode simple case folding to a code point
+static uint32_t str_foldCase(uint32_t codePoint) {
+    if (codePoint < 0x80) return str_foldAscii((unsigned char)codePoint);
+
+    int lo = 0, hi = (int)(sizeof(str_caseFoldRanges) / sizeof(str_caseFoldRanges[0])) - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        const StrCaseFoldRange* range = &str_caseFoldRanges[mid];
+        if (codePoint < range->first) {
+            hi = mid - 1;
+        } else if (codePoint > range->last) {
+            lo = mid + 1;
+        } else {
+            return (codePoint - range->first) % range->stride ? codePoint : codePoint + range->delta;
+        }
+    }
+    return codePoint;
+}
 
-    int padCount = targetLength - strLen;
-    while (padCount > padLen) {
-        str_concat(temp, padStr, temp);
-        padCount -= padLen;
+// Stores every code point whose simple case fold is target (at most four) and returns how many
+static int str_foldVariants(uint32_t target, uint32_t variants[4]) {
+    int found = 0;
+    variants[found++] = target;
+    if (target - 'a' < 26) variants[found++] = target ^ 0x20;
+
+    int count = (int)(sizeof(str_caseFoldRanges) / sizeof(str_caseFoldRanges[0]));
+    for (int i = 0; i < count && found < 4; i++) {
+        const StrCaseFoldRange* range = &str_caseFoldRanges[i];
+        uint32_t source = target - range->delta;
+        if (source < range->first || source > range->last || (source - range->first) % range->stride) continue;
+        variants[found++] = source;
     }
-    while (padCount-- > 0) strncat(temp, padStr, 1);
+    return found;
+}
 
-    str_concat(temp, str, result);
-    return (str_last_error = STR_SUCCESS);
+// Bad-character shifts for a well-formed needle under simple case folding. A match spells each
+// needle code point with any of its variants, so byte lengths differ between matches: the table
+// is built over the shortest match, and every byte a variant can put at an offset inside it
+// limits the shift to that offset's distance from the last byte.
+typedef struct {
+    size_t minLen;
+    bool leads[256];     // Lead bytes a match can start with
+    size_t shift[256];
+} StrFoldSkip;
+
+static void str_buildFoldSkip(const unsigned char* needle, size_t needleLen, StrFoldSkip* skip) {
+    // First pass: the length of the shortest match
+    size_t minLen = 0;
+    for (size_t j = 0; j < needleLen; ) {
+        uint32_t codePoint, variants[4];
+        int seqLen = str_decodeSequence(needle + j, needleLen - j, &codePoint);
+        if (!seqLen) {
+            // Ill-formed bytes only match themselves
+            minLen++;
+            j++;
+            continue;
+        }
+        int count = str_foldVariants(str_foldCase(codePoint), variants);
+        size_t shortest = 4;
+        for (int v = 0; v < count; v++) {
+            if (str_encodedLength(variants[v]) < shortest) shortest = str_encodedLength(variants[v]);
+        }
+        minLen += shortest;
+        j += seqLen;
+    }
+
+    skip->minLen = minLen;
+    memset(skip->leads, 0, sizeof(skip->leads));
+    for (int b = 0; b < 256; b++) skip->shift[b] = minLen;
+
+    // Second pass: a variant of the code point at [fewest, most] bytes into the match puts its
+    // byte r anywhere from fewest + r to most + r
+    size_t fewest = 0, most = 0;
+    for (size_t j = 0; j < needleLen && (j == 0 || fewest + 1 < minLen); ) {
+        uint32_t codePoint, variants[4];
+        int seqLen = str_decodeSequence(needle + j, needleLen - j, &codePoint);
+        int count = seqLen ? str_foldVariants(str_foldCase(codePoint), variants) : 1;
+
+        size_t shortest = 4, longest = 0;
+        for (int v = 0; v < count; v++) {
+            unsigned char encoded[4] = { needle[j] };
+            size_t encodedLen = 1;
+            if (seqLen) {
+                encodedLen = str_encodedLength(variants[v]);
+                str_encodeCodePoint(variants[v], (char*)encoded);
+            }
+            if (encodedLen < shortest) shortest = encodedLen;
+            if (encodedLen > longest) longest = encodedLen;
+            if (j == 0) skip->leads[encoded[0]] = true;
+
+            for (size_t r = 0; r < encodedLen && fewest + r + 1 < minLen; r++) {
+                size_t offset = most + r + 1 < minLen ? most + r : minLen - 2;
+                if (minLen - 1 - offset < skip->shift[encoded[r]]) skip->shift[encoded[r]] = minLen - 1 - offset;
+            }
+        }
+        fewest += shortest;
+        most += longest;
+        j += seqLen ? seqLen : 1;
+    }
 }
 
-// Pads a string with a given character at the end to reach a target length
-StrError str_padEnd(const char* str, int targetLength, const char* padStr, char* result, size_t resultSize) {
-    if (!str || !padStr || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+// Checks whether the text at str starts with substr under simple case folding
+static bool str_startsWithFold(const unsigned char* str, size_t len, const unsigned char* substr, size_t substrLen) {
+    size_t i = 0, j = 0;
+    while (j < substrLen) {
+        if (i >= len) return false;
+
+        uint32_t a, b;
+        int aLen = str_decodeSequence(str + i, len - i, &a);
+        int bLen = str_decodeSequence(substr + j, substrLen - j, &b);
+        if (!aLen || !bLen) {
+            // Ill-formed bytes only match themselves
+            if (aLen || bLen || str[i] != substr[j]) return false;
+            aLen = bLen = 1;
+        } else if (a != b && str_foldCase(a) != str_foldCase(b)) {
+            return false;
+        }
+        i += aLen;
+        j += bLen;
+    }
+    return true;
+}
 
-    int strLen = str_length(str);
-    int padLen = str_length(padStr);
-    if (targetLength >= resultSize) return (str_last_error = STR_ERROR_MEMORY_ALLOCATION);
+// Finds the first case-insensitive occurrence of substr in the first len bytes of str
+static const char* str_findFold(const char* str, size_t len, const char* substr, size_t substrLen) {
+    if (substrLen == 0) return str;
+
+    // An ASCII needle can only match ASCII text, except through KELVIN SIGN (k) and LONG S (s).
+    // A match through one of those that starts before the first ASCII match also has that
+    // character before it, so only that window is searched for them.
+    const char* hit = NULL;
+    size_t limit = len;
+    if (str_loadKernels()->asciiPrefix(substr, substrLen) == substrLen) {
+        hit = str_loadKernels()->findFold(str, len, substr, substrLen);
+        bool foldsFromNonAscii = false;
+        for (size_t i = 0; i < substrLen; i++) {
+            unsigned char folded = str_foldAscii((unsigned char)substr[i]);
+            if (folded == 'k' || folded == 's') foldsFromNonAscii = true;
+        }
+        limit = hit ? (size_t)(hit - str) : len;
+        if (!foldsFromNonAscii || (!str_loadKernels()->find(str, limit, "\xE2\x84\xAA", 3) &&
+                                   !str_loadKernels()->find(str, limit, "\xC5\xBF", 2))) {
+            return hit;
+        }
+    }
 
-    str_concat(str, "", result);
+    const unsigned char* bytes = (const unsigned char*)str;
+    const unsigned char* needle = (const unsigned char*)substr;
+    uint32_t first;
+    if (!str_decodeSequence(needle, substrLen, &first)) {
+        // An ill-formed needle is compared at every code point boundary
+        for (size_t i = 0; i < len; ) {
+            if (str_startsWithFold(bytes + i, len - i, needle, substrLen)) return str + i;
+            int seqLen = str_decodeSequence(bytes + i, len - i, NULL);
+            i += seqLen ? seqLen : 1;
+        }
+        return NULL;
+    }
 
-    int padCount = targetLength - strLen;
-    while (padCount > padLen) {
-        str_concat(result, padStr, result);
-        padCount -= padLen;
+    // Horspool over the last byte of the shortest possible match; candidates must also start with
+    // the lead byte of a code point that folds like the needle's first
+    StrFoldSkip skip;
+    str_buildFoldSkip(needle, substrLen, &skip);
+    for (size_t i = 0; i < limit && skip.minLen <= len - i; i += skip.shift[bytes[i + skip.minLen - 1]]) {
+        if (skip.leads[bytes[i]] && str_startsWithFold(bytes + i, len - i, needle, substrLen)) return str + i;
     }
-    while (padCount-- > 0) strncat(result, padStr, 1);
+    return hit;
+}
 
-    result[targetLength] = '\0';
-    return (str_last_error = STR_SUCCESS);
+// Returns the index of the first occurrence of a substring, ignoring case
+int str_indexOfIgnoreCase(const char* str, const char* substr) {
+    STR_STATS_SCOPE(STR_FN_INDEX_OF_IGNORE_CASE);
+    if (!str || !substr) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return -1;
+    }
+
+    size_t len = strlen(str);
+    const char* pos = str_findFold(str, len, substr, strlen(substr));
+    STR_STATS_BYTES(len);
+    str_last_error = STR_SUCCESS;
+    if (!pos) return -1;
+    return str_countCodePoints(str, pos - str);
 }
 
-// Replaces all occurrences of a substring with another substring in a string
-StrError str_replace(const char* str, const char* searchValue, const char* newValue, char* result) {
-    if (!str || !searchValue || !newValue || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+// Checks if a string includes a given substring, ignoring case
+int str_includesIgnoreCase(const char* str, const char* substr) {
+    STR_STATS_SCOPE(STR_FN_INCLUDES_IGNORE_CASE);
+    if (!str || !substr) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return 0;
+    }
+
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+    str_last_error = STR_SUCCESS;
+    return str_findFold(str, len, substr, strlen(substr)) != NULL;
+}
+
+// ==== FIND ALL ====
+
+// Visits every occurrence of substr in one pass, storing the first maxPositions of them.
+// Code point indices advance incrementally from the previous stored match.
+static int str_scanOccurrences(const char* str, size_t len, const char* substr, size_t substrLen,
+                               bool overlapping, StrPosition* positions, int maxPositions) {
+    int count = 0;
+
+    // An empty substring matches at every code point boundary, counted like str_countCodePoints
+    if (substrLen == 0) {
+        const unsigned char* bytes = (const unsigned char*)str;
+        uint32_t codePoint;
+        for (size_t i = 0; ; count++) {
+            if (count < maxPositions) {
+                positions[count].index = count;
+                positions[count].byteOffset = (int)i;
+            }
+            if (i >= len) break;
+            int seqLen = str_utf8Decode(bytes + i, len - i, &codePoint);
+            i += seqLen < 0 ? -seqLen : seqLen;
+        }
+        return count + 1;
+    }
 
+    size_t counted = 0;
+    int index = 0;
     const char* pos = str;
-    int searchLenBytes = strlen(searchValue);
-    int newValueLenBytes = strlen(newValue);
+    while ((pos = str_loadKernels()->find(pos, len - (pos - str), substr, substrLen))) {
+        size_t offset = pos - str;
+        if (count < maxPositions) {
+            index += str_countCodePoints(str + counted, offset - counted);
+            counted = offset;
+            positions[count].index = index;
+            positions[count].byteOffset = (int)offset;
+        }
+        count++;
+        pos += overlapping ? 1 : substrLen;
+    }
+    return count;
+}
 
-    while ((pos = str_findHelper(pos, searchValue)) != NULL) {
-        int bytesToCopy = pos - str;
-        strncpy(result, str, bytesToCopy);
-        result += bytesToCopy;
-        strcpy(result, newValue);
-        result += newValueLenBytes;
-        str = pos + searchLenBytes;
-        pos = str;
+// Stores the positions of up to maxPositions occurrences of substr and returns how many there are in total
+int str_findAll(const char* str, const char* substr, bool overlapping, StrPosition* positions, int maxPositions) {
+    STR_STATS_SCOPE(STR_FN_FIND_ALL);
+    if (!str || !substr || (!positions && maxPositions > 0)) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return -1;
     }
 
-    strcpy(result, str);
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+    str_last_error = STR_SUCCESS;
+    return str_scanOccurrences(str, len, substr, strlen(substr), overlapping, positions, maxPositions);
+}
+
+// Counts the occurrences of substr in a string
+int str_count(const char* str, const char* substr, bool overlapping) {
+    STR_STATS_SCOPE(STR_FN_COUNT_OCCURRENCES);
+    if (!str || !substr) {
+        str_last_error = STR_ERROR_NULL_INPUT;
+        return -1;
+    }
+
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+    str_last_error = STR_SUCCESS;
+    return str_scanOccurrences(str, len, substr, strlen(substr), overlapping, NULL, 0);
+}
+
+// ==== GRAPHEME CLUSTERS ====
+
+// Returns the Grapheme_Cluster_Break value of an ASCII byte
+static inline int str_graphemeBreakAscii(unsigned char byte) {
+    if (byte >= 0x20 && byte != 0x7F) return STR_GCB_OTHER;
+    return byte == '\r' ? STR_GCB_CR : byte == '\n' ? STR_GCB_LF : STR_GCB_CONTROL;
+}
+
+// Returns the Grapheme_Cluster_Break value of a code point, telling Hangul LV and LVT syllables apart
+static inline int str_graphemeBreak(uint32_t codePoint) {
+    // Below U+0300 only the controls, SOFT HYPHEN and the two pictographs are not Other
+    if (codePoint < 0x300) {
+        if (codePoint < 0x80) return str_graphemeBreakAscii((unsigned char)codePoint);
+        if (codePoint < 0xA0 || codePoint == 0xAD) return STR_GCB_CONTROL;
+        return codePoint == 0xA9 || codePoint == 0xAE ? STR_GCB_EXTENDED_PICTOGRAPHIC : STR_GCB_OTHER;
+    }
+
+    uint32_t i = codePoint;
+    if (i >= 0x20000) {
+        if (i - 0xE0000 >= 0x1000) return STR_GCB_OTHER;
+        i -= 0xE0000 - 0x20000;
+    }
+
+    uint8_t pair = str_graphemeBreakBlocks[str_graphemeBreakIndex[i >> STR_GRAPHEME_BLOCK_SHIFT]]
+                                          [(i & ((1u << STR_GRAPHEME_BLOCK_SHIFT) - 1)) >> 1];
+    int value = (pair >> ((i & 1) * 4)) & 0xF;
+    if (value == STR_GCB_LV && (codePoint - 0xAC00) % 28 != 0) value = STR_GCB_LVT;
+    return value;
+}
+
+// Rule state inside a cluster: the break value of the last code point, whether the cluster so far
+// ends in Extended_Pictographic Extend* (1) or in that followed by ZWJ (2), and whether its last
+// regional indicator still waits for the other half of a flag
+typedef struct {
+    int prev;
+    int pictographic;
+    bool regionalOpen;
+} StrGraphemeState;
+
+// Starts a cluster with a code point of break value first
+static inline void str_graphemeStart(StrGraphemeState* state, int first) {
+    state->prev = first;
+    state->pictographic = first == STR_GCB_EXTENDED_PICTOGRAPHIC;
+    state->regionalOpen = first == STR_GCB_REGIONAL_INDICATOR;
+}
+
+// Applies rules GB3-GB13 of UAX #29 to the code point of break value next. Returns true if a cluster
+// boundary falls before it, in which case next starts the new cluster.
+static inline bool str_graphemeBoundary(StrGraphemeState* state, int next) {
+    int prev = state->prev;
+    bool join;
+    if (prev == STR_GCB_CR || prev == STR_GCB_LF || prev == STR_GCB_CONTROL) {
+        join = prev == STR_GCB_CR && next == STR_GCB_LF;                       // GB3, GB4
+    } else if (next == STR_GCB_CR || next == STR_GCB_LF || next == STR_GCB_CONTROL) {
+        join = false;                                                          // GB5
+    } else if (prev == STR_GCB_PREPEND) {
+        join = true;                                                           // GB9b
+    } else {
+        switch (next) {
+            case STR_GCB_EXTEND:
+            case STR_GCB_ZWJ:
+            case STR_GCB_SPACING_MARK:
+                join = true;                                                   // GB9, GB9a
+                break;
+            case STR_GCB_L:
+            case STR_GCB_LV:
+            case STR_GCB_LVT:
+                join = prev == STR_GCB_L;                                      // GB6
+                break;
+            case STR_GCB_V:
+                join = prev == STR_GCB_L || prev == STR_GCB_LV || prev == STR_GCB_V;  // GB6, GB7
+                break;
+            case STR_GCB_T:
+                join = prev == STR_GCB_LV || prev == STR_GCB_V || prev == STR_GCB_LVT || prev == STR_GCB_T;  // GB7, GB8
+                break;
+            case STR_GCB_EXTENDED_PICTOGRAPHIC:
+                join = state->pictographic == 2;                               // GB11
+                break;
+            case STR_GCB_REGIONAL_INDICATOR:
+                join = state->regionalOpen;                                    // GB12, GB13
+                break;
+            default:
+                join = false;                                                  // GB999
+                break;
+        }
+    }
+    if (!join) {
+        str_graphemeStart(state, next);
+        return true;
+    }
+
+    if (next == STR_GCB_EXTENDED_PICTOGRAPHIC) state->pictographic = 1;
+    else if (state->pictographic == 1 && next == STR_GCB_ZWJ) state->pictographic = 2;
+    else if (state->pictographic != 1 || next != STR_GCB_EXTEND) state->pictographic = 0;
+    state->regionalOpen = next == STR_GCB_REGIONAL_INDICATOR && !state->regionalOpen;
+    state->prev = next;
+    return false;
+}
+
+// Steps the iterator over the extended grapheme cluster after the cursor; returns false at the end.
+// Ill-formed sequences count as U+FFFD.
+static bool str_stepGrapheme(StrIter* it) {
+    const unsigned char* pos = (const unsigned char*)it->pos;
+    if (it->end ? it->pos >= it->end : *pos == 0) return false;
+
+    // Two ASCII bytes in a row always break between them, except CR LF
+    if (pos[0] < 0x80 && pos[0] != '\r' && (it->pos + 1 == it->end || pos[1] < 0x80)) {
+        it->pos++;
+        return true;
+    }
+
+    StrGraphemeState state;
+    str_graphemeStart(&state, str_graphemeBreak(str_iterNext(it)));
+    for (;;) {
+        const char* boundary = it->pos;
+        int32_t codePoint = str_iterNext(it);
+        if (codePoint == STR_ITER_END) return true;
+        if (str_graphemeBoundary(&state, str_graphemeBreak(codePoint))) {
+            it->pos = boundary;
+            return true;
+        }
+    }
+}
+
+// Returns the byte length of the grapheme cluster after the cursor and steps over it
+int str_iterNextGrapheme(StrIter* it) {
+    const char* start = it->pos;
+    if (!str_stepGrapheme(it)) return STR_ITER_END;
+    return (int)(it->pos - start);
+}
+
+// Code points a run of ASCII must reach before it is handed to the asciiPrefix kernel, and the most
+// an unmeasured string is measured ahead of the clusters asked for
+#define STR_GRAPHEME_RUN 16
+#define STR_GRAPHEME_WINDOW 4096
+
+// Steps over up to maxClusters grapheme clusters of a string, returning the number of bytes stepped
+// over and storing the number of clusters in *count. len is the length of the string, or SIZE_MAX if
+// the caller has not measured it; the string is then only measured as far as the clusters need.
+//
+// Short ASCII runs go through the rules inline without table lookups. Inside a long run only the
+// last byte can be extended by what follows, so the rest is counted by the asciiPrefix kernel.
+static size_t str_graphemeAdvance(const char* str, size_t len, size_t maxClusters, size_t* count) {
+    const unsigned char* bytes = (const unsigned char*)str;
+    bool measured = len != SIZE_MAX;
+    size_t known = measured ? len : 0;  // No NUL before this offset
+    size_t i = 0, clusters = 0;
+    bool runStart = true;
+
+    // A control before the text makes the first code point start a cluster
+    StrGraphemeState state;
+    str_graphemeStart(&state, STR_GCB_CONTROL);
+    for (;;) {
+        unsigned char byte = bytes[i];
+        if (byte == 0) break;
+
+        size_t room = maxClusters - clusters;
+        if (byte < 0x80 && runStart && room > STR_GRAPHEME_RUN &&
+            state.prev != STR_GCB_PREPEND && state.prev != STR_GCB_CR) {
+            runStart = false;
+            size_t want = room < STR_GRAPHEME_WINDOW ? room + 1 : STR_GRAPHEME_WINDOW;
+            if (known < i) known = i;
+            if (!measured && known - i < want) {
+                size_t step = i + want - known;
+                // memchr stops at the first match, so it never reads past the terminator
+                const char* nul = memchr(str + known, '\0', step);
+                known = nul ? (size_t)(nul - str) : known + step;
+                measured = nul != NULL;
+            }
+
+            size_t window = known - i < want ? known - i : want;
+            uint64_t head[2];
+            if (window >= STR_GRAPHEME_RUN) memcpy(head, str + i, sizeof(head));
+            if (window >= STR_GRAPHEME_RUN && !((head[0] | head[1]) & 0x8080808080808080ULL)) {
+                size_t runEnd = i + str_loadKernels()->asciiPrefix(str + i, window);
+
+                // Leave the last byte (and a CR before it) to the rules, as marks may follow it
+                size_t end = runEnd - 1;
+                if (bytes[end - 1] == '\r' && bytes[end] == '\n') end--;
+
+                // Every byte is a cluster of its own except the LF of a CR LF pair
+                clusters += end - i - str_loadKernels()->countCrLf(str + i, end - i);
+                str_graphemeStart(&state, str_graphemeBreakAscii(bytes[end - 1]));
+                runStart = runEnd == i + window;
+                i = end;
+                continue;
+            }
+        }
+
+        // Printable ASCII never joins what comes before it unless that is Prepend
+        if (byte >= 0x20 && byte < 0x7F && state.prev != STR_GCB_PREPEND) {
+            if (room == 0) break;
+            size_t start = i;
+            do {
+                i++;
+            } while ((size_t)(i - start) < room && bytes[i] >= 0x20 && bytes[i] < 0x7F);
+            clusters += i - start;
+            str_graphemeStart(&state, STR_GCB_OTHER);
+            continue;
+        }
+
+        int value, seqLen = 1;
+        if (byte < 0x80) {
+            value = str_graphemeBreakAscii(byte);
+        } else {
+            // Well-formed two- and three-byte sequences are decoded directly. Otherwise a NUL ends
+            // any sequence, so up to four bytes may be offered to the decoder.
+            uint32_t codePoint;
+            if (byte >= 0xC2 && byte < 0xE0 && (bytes[i + 1] & 0xC0) == 0x80) {
+                codePoint = ((uint32_t)(byte & 0x1F) << 6) | (bytes[i + 1] & 0x3F);
+                seqLen = 2;
+            } else if ((byte & 0xF0) == 0xE0 && (bytes[i + 1] & 0xC0) == 0x80 && (bytes[i + 2] & 0xC0) == 0x80 &&
+                       (codePoint = ((uint32_t)(byte & 0x0F) << 12) | ((uint32_t)(bytes[i + 1] & 0x3F) << 6) |
+                                    (bytes[i + 2] & 0x3F)) >= 0x800 && codePoint - 0xD800 >= 0x800) {
+                seqLen = 3;
+            } else if (byte >= 0xF0 && byte < 0xF5 && (bytes[i + 1] & 0xC0) == 0x80 && (bytes[i + 2] & 0xC0) == 0x80 &&
+                       (bytes[i + 3] & 0xC0) == 0x80 &&
+                       (codePoint = ((uint32_t)(byte & 0x07) << 18) | ((uint32_t)(bytes[i + 1] & 0x3F) << 12) |
+                                    ((uint32_t)(bytes[i + 2] & 0x3F) << 6) | (bytes[i + 3] & 0x3F)) - 0x10000 < 0x100000) {
+                seqLen = 4;
+            } else {
+                seqLen = str_utf8Decode(bytes + i, 4, &codePoint);
+                if (seqLen < 0) {
+                    seqLen = -seqLen;
+                    codePoint = 0xFFFD;
+                }
+            }
+            value = str_graphemeBreak(codePoint);
+            runStart = true;
+        }
+        // Other only joins a cluster after Prepend, so it skips the rest of the rules
+        bool boundary;
+        if (value == STR_GCB_OTHER && state.prev != STR_GCB_PREPEND) {
+            str_graphemeStart(&state, STR_GCB_OTHER);
+            boundary = true;
+        } else {
+            boundary = str_graphemeBoundary(&state, value);
+        }
+        if (boundary) {
+            if (room == 0) break;
+            clusters++;
+        }
+        i += seqLen;
+    }
+    *count = clusters;
+    return i;
+}
+
+// Returns the number of extended grapheme clusters (user-perceived characters) in a string
+int str_graphemeLength(const char* str) {
+    STR_STATS_SCOPE(STR_FN_GRAPHEME_LENGTH);
+    if (!str) return -1;
+
+    size_t len = strlen(str);
+    STR_STATS_BYTES(len);
+    size_t count;
+    str_graphemeAdvance(str, len, SIZE_MAX, &count);
+    return (int)count;
+}
+
+// Returns the grapheme cluster at a specific index in a string
+char* str_graphemeAt(const char* str, int index) {
+    STR_STATS_SCOPE(STR_FN_GRAPHEME_AT);
+    if (!str || index < 0) return NULL;
+
+    size_t count;
+    size_t start = str_graphemeAdvance(str, SIZE_MAX, (size_t)index, &count);
+    if (str[start] == '\0') return NULL;
+
+    StrIter it;
+    str_iterInit(&it, str + start);
+    int clusterLen = str_iterNextGrapheme(&it);
+    char* result = malloc(clusterLen + 1);
+    if (!result) return NULL;
+    STR_STATS_ALLOCATION();
+    STR_STATS_BYTES(start + clusterLen);
+    memcpy(result, str + start, clusterLen);
+    result[clusterLen] = '\0';
+    return result;
+}
+
+// Copies the first maxGraphemes grapheme clusters of a string into result without splitting any of them
+StrError str_truncateGraphemes(const char* str, int maxGraphemes, char* result, size_t resultSize) {
+    STR_STATS_SCOPE(STR_FN_TRUNCATE_GRAPHEMES);
+    if (!str || !result) return (str_last_error = STR_ERROR_NULL_INPUT);
+    if (maxGraphemes < 0) return (str_last_error = STR_ERROR_INVALID_INDEX);
+
+    size_t count;
+    size_t end = str_graphemeAdvance(str, SIZE_MAX, (size_t)maxGraphemes, &count);
+    STR_STATS_BYTES(end);
+    if (end >= resultSize) return (str_last_error = STR_ERROR_BUFFER_TOO_SMALL);
+
+    memmove(result, str, end);
+    result[end] = '\0';
     return (str_last_error = STR_SUCCESS);
 }
@@ -2,6 +2,9 @@
 #define STRLIB_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
 
 extern const int unicodeWhitespace[];
 
@@ -11,11 +14,244 @@ typedef enum {
     STR_ERROR_NULL_INPUT,
     STR_ERROR_INVALID_INDEX,
     STR_ERROR_MEMORY_ALLOCATION,
-    STR_ERROR_INVALID_UTF8
+    STR_ERROR_INVALID_UTF8,
+    STR_ERROR_BUFFER_TOO_SMALL,
+    STR_ERROR_INVALID_CODE_UNIT,
+    STR_ERROR_INVALID_PATTERN
 } StrError;
 
+// Unicode normalization forms (UAX #15)
+typedef enum {
+    STR_NFC = 0,
+    STR_NFD,
+    STR_NFKC,
+    STR_NFKD
+} StrNormalizationForm;
+
+// Byte order of UTF-16 code units
+typedef enum {
+    STR_LITTLE_ENDIAN = 0,
+    STR_BIG_ENDIAN
+} StrByteOrder;
+
 extern StrError str_last_error;  // Holds the last error state
 
+// Position of a substring occurrence, as a code point index and a byte offset
+typedef struct {
+    int index;
+    int byteOffset;
+} StrPosition;
+
+// A compiled regular expression (see str_regexCompile)
+typedef struct StrRegex StrRegex;
+
+// Span of a regex match, as code point indices and byte offsets; end is exclusive
+typedef struct {
+    int start;
+    int end;
+    int byteStart;
+    int byteEnd;
+} StrMatch;
+
+// Instruction set tiers the vectorized kernels can be bound to
+typedef enum {
+    STR_ISA_SCALAR = 0,
+    STR_ISA_SSE42,
+    STR_ISA_AVX2,
+    STR_ISA_AVX512
+} StrIsa;
+
+// Functions tracked by the optional STRLIB_STATS instrumentation
+typedef enum {
+    STR_FN_IS_VALID_UTF8 = 0,
+    STR_FN_LENGTH,
+    STR_FN_CHAR_AT,
+    STR_FN_CHAR_CODE_AT,
+    STR_FN_INDEX_OF,
+    STR_FN_LAST_INDEX_OF,
+    STR_FN_CONCAT,
+    STR_FN_TO_LOWER_CASE,
+    STR_FN_TO_UPPER_CASE,
+    STR_FN_TRIM_START,
+    STR_FN_TRIM_END,
+    STR_FN_REPEAT,
+    STR_FN_STARTS_WITH,
+    STR_FN_ENDS_WITH,
+    STR_FN_SLICE,
+    STR_FN_SUBSTRING,
+    STR_FN_FROM_CODE_POINT,
+    STR_FN_INCLUDES,
+    STR_FN_PAD_START,
+    STR_FN_PAD_END,
+    STR_FN_REPLACE,
+    STR_FN_NORMALIZE,
+    STR_FN_TO_WELL_FORMED,
+    STR_FN_TO_UTF16,
+    STR_FN_TO_UTF32,
+    STR_FN_FROM_UTF16,
+    STR_FN_FROM_UTF32,
+    STR_FN_SEARCH,
+    STR_FN_MATCH,
+    STR_FN_MATCH_ALL,
+    STR_FN_INDEX_OF_IGNORE_CASE,
+    STR_FN_INCLUDES_IGNORE_CASE,
+    STR_FN_FIND_ALL,
+    STR_FN_COUNT_OCCURRENCES,
+    STR_FN_CODE_POINT_AT,
+    STR_FN_GRAPHEME_LENGTH,
+    STR_FN_GRAPHEME_AT,
+    STR_FN_TRUNCATE_GRAPHEMES,
+    STR_FN_COUNT
+} StrFunction;
+
+// Number of latency histogram buckets; bucket b counts calls taking [2^b, 2^(b+1)) ns
+#define STR_STATS_BUCKETS 32
+
+// Counters for one function, summed over all threads
+typedef struct {
+    unsigned long long calls;
+    unsigned long long bytes;        // Input bytes processed
+    unsigned long long allocations;  // Heap blocks returned to the caller
+    unsigned long long nanos;        // Total time spent inside the function
+    unsigned long long histogram[STR_STATS_BUCKETS];
+} StrFunctionStats;
+
+typedef struct {
+    StrFunctionStats functions[STR_FN_COUNT];
+} StrStats;
+
+// ==== CPU DISPATCH ====
+// Returns the tier the kernels are bound to, detecting the CPU on first use.
+// Setting STRLIB_ISA=scalar|sse42|avx2|avx512 caps the tier picked at first use.
+StrIsa str_activeIsa(void);
+
+// Returns a printable name for an instruction set tier
+const char* str_isaName(StrIsa isa);
+
+// Rebinds the kernels to the given tier, clamped to what the CPU supports
+StrIsa str_forceIsa(StrIsa isa);
+
+// ==== INSTRUMENTATION ====
+// Returns true when the library was built with -DSTRLIB_STATS
+bool str_stats_enabled(void);
+
+// Returns the name of an instrumented function
+const char* str_functionName(StrFunction fn);
+
+// Copies the counters of all threads into stats (all zero when instrumentation is disabled)
+StrError str_stats_snapshot(StrStats* stats);
+
+// Zeroes the counters of all threads
+void str_stats_reset(void);
+
+// Writes a per-function table of calls, bytes, allocations and latency percentiles to out
+void str_stats_dump(FILE* out);
+
+// ==== CODE POINT ITERATION ====
+// Table-driven UTF-8 decoding after Bjoern Hoehrmann's DFA. The first 256 entries of
+// str_utf8Dfa map a byte to its class (numbered so that 0xFF >> class masks a lead byte's
+// payload); the rest map state + class to the next state, with states spaced 12 apart.
+#define STR_UTF8_ACCEPT 0
+#define STR_UTF8_REJECT 12
+
+// Returned by the iterator at either end of the string
+#define STR_ITER_END (-1)
+
+extern const uint8_t str_utf8Dfa[364];
+
+// Feeds one byte to the decoder; codePoint is complete once the state returns to STR_UTF8_ACCEPT
+static inline uint32_t str_utf8Step(uint32_t* state, uint32_t* codePoint, unsigned char byte) {
+    uint32_t type = str_utf8Dfa[byte];
+    *codePoint = *state != STR_UTF8_ACCEPT ? (byte & 0x3Fu) | (*codePoint << 6) : (0xFFu >> type) & byte;
+    *state = str_utf8Dfa[256 + *state + type];
+    return *state;
+}
+
+// Decodes the sequence at str, reading at most avail bytes. Returns its length, or minus the
+// length of the maximal ill-formed subpart (at least 1) if it is malformed. A NUL always ends
+// a multi-byte sequence, so avail may exceed what is left of a NUL-terminated string.
+static inline int str_utf8Decode(const unsigned char* str, size_t avail, uint32_t* codePoint) {
+    if (str[0] < 0x80) {
+        *codePoint = str[0];
+        return 1;
+    }
+
+    uint32_t state = STR_UTF8_ACCEPT;
+    size_t i = 0;
+    do {
+        if (str_utf8Step(&state, codePoint, str[i]) == STR_UTF8_REJECT) break;
+        i++;
+    } while (state != STR_UTF8_ACCEPT && i < avail);
+
+    if (state == STR_UTF8_ACCEPT) return (int)i;
+    return i ? -(int)i : -1;
+}
+
+// Cursor over the code points of a UTF-8 string, stepping in either direction
+typedef struct {
+    const char* start;  // First byte of the string
+    const char* end;    // One past the last byte, or NULL if the string is NUL-terminated
+    const char* pos;    // Boundary between the previous and the next code point
+} StrIter;
+
+// Starts an iterator at the beginning of a NUL-terminated string
+static inline void str_iterInit(StrIter* it, const char* str) {
+    it->start = it->pos = str;
+    it->end = NULL;
+}
+
+// Starts an iterator at the beginning of the first len bytes of str
+static inline void str_iterInitLength(StrIter* it, const char* str, size_t len) {
+    it->start = it->pos = str;
+    it->end = str + len;
+}
+
+// Returns the code point after the cursor and steps over it, or STR_ITER_END at the end.
+// An ill-formed sequence yields U+FFFD and is stepped over one maximal subpart at a time.
+static inline int32_t str_iterNext(StrIter* it) {
+    const unsigned char* pos = (const unsigned char*)it->pos;
+    if (it->end ? it->pos >= it->end : *pos == 0) return STR_ITER_END;
+
+    uint32_t codePoint;
+    int seqLen = str_utf8Decode(pos, it->end ? (size_t)(it->end - it->pos) : 4, &codePoint);
+    if (seqLen < 0) {
+        it->pos -= seqLen;
+        return 0xFFFD;
+    }
+    it->pos += seqLen;
+    return (int32_t)codePoint;
+}
+
+// Returns the code point before the cursor and steps back over it, or STR_ITER_END at the start.
+// An ill-formed sequence yields U+FFFD per maximal subpart, the same units str_iterNext steps over.
+static inline int32_t str_iterPrev(StrIter* it) {
+    const unsigned char* start = (const unsigned char*)it->start;
+    const unsigned char* pos = (const unsigned char*)it->pos;
+    if (pos <= start) return STR_ITER_END;
+    if (pos[-1] < 0x80) {
+        it->pos--;
+        return pos[-1];
+    }
+
+    // Back up over at most three continuation bytes. Every other byte starts a unit, so decoding
+    // forward from one either ends at the cursor or leaves the byte before it on its own.
+    const unsigned char* lead = pos - 1;
+    while (lead > start && pos - lead < 4 && (*lead & 0xC0) == 0x80) lead--;
+
+    uint32_t codePoint;
+    int seqLen = (*lead & 0xC0) == 0x80 ? -1 : str_utf8Decode(lead, (size_t)(pos - lead), &codePoint);
+    if ((seqLen < 0 ? -seqLen : seqLen) == pos - lead) {
+        it->pos = (const char*)lead;
+        return seqLen < 0 ? 0xFFFD : (int32_t)codePoint;
+    }
+    it->pos--;
+    return 0xFFFD;
+}
+
+// Returns the byte length of the extended grapheme cluster (UAX #29) after the cursor and steps
+// over it, or STR_ITER_END at the end
+int str_iterNextGrapheme(StrIter* it);
+
 // ==== HELPER FUNCTIONS ====
 // Copies characters from src to dest from start to end
 StrError str_copyRange(const char* src, int start, int end, char* dest);
@@ -95,7 +331,7 @@ void str_slice(const char* str, int start, int end, char* result);
 // Extracts a substring from a string and stores it in the result buffer
 StrError str_substring(const char* str, int start, int end, char* result);
 
-// Returns the Unicode code point at a specific index in a string
+// Stores the Unicode code point at a specific index in a string; returns a StrError
 int str_codePointAt(const char* str, int index, int* codePoint);
 
 // Converts a Unicode code point to a string
@@ -113,4 +349,75 @@ StrError str_padEnd(const char* str, int targetLength, const char* padStr, char*
 // Replaces all occurrences of a substring with another substring in a string
 StrError str_replace(const char* str, const char* searchValue, const char* newValue, char* result);
 
+// Checks if a string is already in the given normalization form
+bool str_isNormalized(const char* str, StrNormalizationForm form);
+
+// Normalizes a string into the result buffer (result may be str itself)
+StrError str_normalize(const char* str, StrNormalizationForm form, char* result, size_t resultSize);
+
+// Checks if a string is well-formed UTF-8
+bool str_isWellFormed(const char* str);
+
+// Replaces every ill-formed sequence with U+FFFD and stores the result (result may be str itself)
+StrError str_toWellFormed(const char* str, char* result, size_t resultSize);
+
+// Returns the number of UTF-16 code units needed to hold a UTF-8 string (str_length gives the UTF-32 count)
+int str_utf16Length(const char* str);
+
+// Transcodes a UTF-8 string to zero-terminated UTF-16; resultSize counts code units
+StrError str_toUTF16(const char* str, StrByteOrder order, uint16_t* result, size_t resultSize);
+
+// Transcodes a UTF-8 string to zero-terminated UTF-32 in host byte order; resultSize counts code points
+StrError str_toUTF32(const char* str, uint32_t* result, size_t resultSize);
+
+// Returns the number of UTF-8 bytes needed to hold srcLen units of UTF-16
+int str_utf8LengthFromUTF16(const uint16_t* src, size_t srcLen, StrByteOrder order);
+
+// Transcodes srcLen units of UTF-16 to a UTF-8 string
+StrError str_fromUTF16(const uint16_t* src, size_t srcLen, StrByteOrder order, char* result, size_t resultSize);
+
+// Returns the number of UTF-8 bytes needed to hold srcLen UTF-32 code points
+int str_utf8LengthFromUTF32(const uint32_t* src, size_t srcLen);
+
+// Transcodes srcLen UTF-32 code points in host byte order to a UTF-8 string
+StrError str_fromUTF32(const uint32_t* src, size_t srcLen, char* result, size_t resultSize);
+
+// Compiles a regular expression for matching in linear time; returns NULL if the pattern is invalid.
+// Searches fill and flush a lazy DFA cache inside the regex, so one StrRegex must not be used by
+// several threads at once; compile one per thread instead.
+StrRegex* str_regexCompile(const char* pattern);
+
+// Frees a compiled regular expression
+void str_regexFree(StrRegex* regex);
+
+// Returns the code point index of the first match, or -1 if there is none
+int str_search(StrRegex* regex, const char* str);
+
+// Finds the first (leftmost-first) match; returns false if there is none
+bool str_match(StrRegex* regex, const char* str, StrMatch* match);
+
+// Stores up to maxMatches non-overlapping matches and returns the total number of matches
+int str_matchAll(StrRegex* regex, const char* str, StrMatch* matches, int maxMatches);
+
+// Returns the code point index of the first occurrence of substr, comparing Unicode simple case folds
+int str_indexOfIgnoreCase(const char* str, const char* substr);
+
+// Checks if a string includes a given substring, comparing Unicode simple case folds
+int str_includesIgnoreCase(const char* str, const char* substr);
+
+// Stores up to maxPositions occurrences of substr (overlapping or not) and returns the total number
+int str_findAll(const char* str, const char* substr, bool overlapping, StrPosition* positions, int maxPositions);
+
+// Counts the occurrences of substr in a string, overlapping or not
+int str_count(const char* str, const char* substr, bool overlapping);
+
+// Returns the number of extended grapheme clusters (user-perceived characters) in a string
+int str_graphemeLength(const char* str);
+
+// Returns the grapheme cluster at a specific index in a string
+char* str_graphemeAt(const char* str, int index);
+
+// Copies the first maxGraphemes grapheme clusters into result without splitting any (result may be str itself)
+StrError str_truncateGraphemes(const char* str, int maxGraphemes, char* result, size_t resultSize);
+
 #endif // STRLIB_H
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include "strlib.h"
 #include <stdlib.h>
+#include <string.h>
 
 
 void test_ascii_cases() {
@@ -204,10 +205,332 @@ void test_utf8_with_emojis_cases() {
     printf("Uppercase (UTF-8 + Emojis): %s\n", utf8EmojiStr); // Should print "HELLO, 🌍🚀!"
 }
 
+void test_dispatch_cases() {
+    printf("\n=== CPU Dispatch Tests ===\n");
+
+    printf("Active ISA: %s\n", str_isaName(str_activeIsa())); // Should print the best tier of this CPU
+
+    // Long enough to exercise every vector width plus the scalar tails
+    const char* text = "  \u3000 The quick brown fox jumps over the lazy dog, Héllö 世界 🌍🚀! The quick brown fox jumps over the lazy cat.";
+    const char* invalid = "This sentence is long enough for a full vector block before \xE0\x80\xAF the overlong sequence";
+
+    // Restored afterwards so a tier forced through STRLIB_ISA covers the rest of the suite
+    StrIsa saved = str_activeIsa();
+    for (int isa = STR_ISA_SCALAR; isa <= STR_ISA_AVX512; isa++) {
+        StrIsa bound = str_forceIsa((StrIsa)isa);
+        char buffer[256];
+
+        str_concat(text, "", buffer);
+        str_trimStart(buffer);
+        str_toUpperCase(buffer);
+
+        // Every tier should print: length 106, index 97, valid 1/0, "THE QUICK ... LAZY CAT."
+        printf("[%s] length: %d, indexOf 'lazy cat': %d, valid: %d/%d, upper: %s\n",
+               str_isaName(bound), str_length(text), str_indexOf(text, "lazy cat"),
+               str_isValidUTF8(text), str_isValidUTF8(invalid), buffer);
+    }
+
+    str_forceIsa(saved);
+}
+
+void test_stats_cases() {
+    printf("\n=== Instrumentation Tests ===\n");
+
+    printf("Statistics enabled: %d\n", str_stats_enabled()); // Should print 1 when built with -DSTRLIB_STATS
+
+    str_stats_reset();
+    str_length("Hello, World!");
+    str_length("Héllö, 世界!");
+    free(str_charAt("Hello, World!", 7));
+    free(str_fromCodePoint(0x1F30D));
+
+    StrStats stats;
+    str_stats_snapshot(&stats);
+    printf("str_length calls: %llu, bytes: %llu\n", stats.functions[STR_FN_LENGTH].calls,
+           stats.functions[STR_FN_LENGTH].bytes); // Should print 2 and 29 (0 and 0 when disabled)
+    printf("Allocations: %llu\n", stats.functions[STR_FN_CHAR_AT].allocations +
+           stats.functions[STR_FN_FROM_CODE_POINT].allocations); // Should print 2 (0 when disabled)
+
+    str_stats_dump(stdout);
+}
+
+void test_normalization_cases() {
+    printf("\n=== Normalization Tests ===\n");
+
+    char result[100];
+
+    // Test str_normalize NFC with a decomposed accent
+    str_normalize("Cafe\u0301", STR_NFC, result, sizeof(result));
+    printf("NFC of 'Cafe' + U+0301: %s (%d bytes)\n", result, (int)strlen(result)); // Should print "Café (5 bytes)"
+
+    // Test str_normalize NFD with a precomposed accent
+    str_normalize("Café", STR_NFD, result, sizeof(result));
+    printf("NFD of 'Café': %s (%d bytes)\n", result, (int)strlen(result)); // Should print "Café (6 bytes)"
+
+    // Test str_normalize NFKC with a ligature and full-width letters
+    str_normalize("\uFB01le \uFF21\uFF22", STR_NFKC, result, sizeof(result));
+    printf("NFKC of 'ﬁle ＡＢ': %s\n", result); // Should print "file AB"
+
+    // Test str_normalize NFC with Hangul jamo and combining mark reordering
+    str_normalize("\u1100\u1161\u11A8 a\u0301\u0323", STR_NFC, result, sizeof(result));
+    printf("NFC of jamo and marks: %s\n", result); // Should print "각 ạ́"
+
+    // Test str_normalize in place
+    char inPlace[20] = "A\u030A";
+    str_normalize(inPlace, STR_NFC, inPlace, sizeof(inPlace));
+    printf("NFC in place: %s (%d bytes)\n", inPlace, (int)strlen(inPlace)); // Should print "Å (2 bytes)"
+
+    // Test str_isNormalized
+    printf("ASCII is NFC: %d\n", str_isNormalized("Hello, World!", STR_NFC)); // Should print 1
+    printf("'é' decomposed is NFC: %d\n", str_isNormalized("e\u0301", STR_NFC)); // Should print 0
+    printf("'é' decomposed is NFD: %d\n", str_isNormalized("e\u0301", STR_NFD)); // Should print 1
+
+    // Test the buffer size check
+    printf("Too small buffer: %d\n", str_normalize("Cafe\u0301", STR_NFC, result, 4) == STR_ERROR_BUFFER_TOO_SMALL); // Should print 1
+}
+
+void test_well_formed_cases() {
+    printf("\n=== Well-Formed Tests ===\n");
+
+    char result[100];
+
+    // Test str_isWellFormed
+    printf("'Héllö' is well-formed: %d\n", str_isWellFormed("Héllö")); // Should print 1
+    printf("Lone continuation byte is well-formed: %d\n", str_isWellFormed("abc\x80")); // Should print 0
+
+    // Test str_toWellFormed with a truncated 4-byte sequence (one maximal subpart)
+    str_toWellFormed("Hi \xF0\x9F\x8C!", result, sizeof(result));
+    printf("Truncated emoji repaired: %s\n", result); // Should print "Hi �!"
+
+    // Test str_toWellFormed with an encoded surrogate (three maximal subparts)
+    str_toWellFormed("a\xED\xA0\x80" "b", result, sizeof(result));
+    printf("Surrogate repaired: %s\n", result); // Should print "a���b"
+
+    // Test str_toWellFormed in place, where the output grows
+    char inPlace[20] = "x\xFFy\xC3";
+    str_toWellFormed(inPlace, inPlace, sizeof(inPlace));
+    printf("Repaired in place: %s\n", inPlace); // Should print "x�y�"
+}
+
+void test_transcoding_cases() {
+    printf("\n=== Transcoding Tests ===\n");
+
+    const char* text = "Héllö, 世界 🌍!";
+    uint16_t utf16[32];
+    uint32_t utf32[32];
+    char result[100];
+
+    // Test str_utf16Length (the emoji needs a surrogate pair)
+    int units = str_utf16Length(text);
+    printf("UTF-16 length of '%s': %d\n", text, units); // Should print 13
+
+    // Test str_toUTF16 little- and big-endian
+    str_toUTF16(text, STR_LITTLE_ENDIAN, utf16, 32);
+    const unsigned char* raw = (const unsigned char*)utf16;
+    printf("UTF-16LE of 'H': %02X %02X\n", raw[0], raw[1]); // Should print "48 00"
+    str_toUTF16(text, STR_BIG_ENDIAN, utf16, 32);
+    printf("UTF-16BE of 'H': %02X %02X\n", raw[0], raw[1]); // Should print "00 48"
+
+    // Test str_fromUTF16 round trip
+    str_fromUTF16(utf16, units, STR_BIG_ENDIAN, result, sizeof(result));
+    printf("UTF-16BE round trip: %s\n", result); // Should print "Héllö, 世界 🌍!"
+
+    // Test str_toUTF32 and str_fromUTF32
+    str_toUTF32(text, utf32, 32);
+    printf("UTF-32 of index 10: U+%04X\n", (unsigned)utf32[10]); // Should print "U+1F30D"
+    str_fromUTF32(utf32, str_length(text), result, sizeof(result));
+    printf("UTF-32 round trip: %s\n", result); // Should print "Héllö, 世界 🌍!"
+
+    // Test the error paths
+    uint16_t unpaired[] = { 0x0041, 0xD83C };
+    printf("Unpaired surrogate: %d\n", str_fromUTF16(unpaired, 2, STR_LITTLE_ENDIAN, result, sizeof(result)) == STR_ERROR_INVALID_CODE_UNIT); // Should print 1
+    printf("Too small buffer: %d\n", str_toUTF16(text, STR_LITTLE_ENDIAN, utf16, units) == STR_ERROR_BUFFER_TOO_SMALL); // Should print 1
+}
+
+void test_regex_cases() {
+    printf("\n=== Regex Tests ===\n");
+
+    const char* log = "ts=2026-10-18 user=Zoë latency=42ms status=200";
+    StrMatch match;
+
+    // Test str_search and str_match (indices are in code points)
+    StrRegex* latency = str_regexCompile("latency=\\d+");
+    printf("Search latency: %d\n", str_search(latency, log)); // Should print 23
+    str_match(latency, log, &match);
+    printf("Match latency: %d-%d (bytes %d-%d)\n", match.start, match.end, match.byteStart, match.byteEnd); // Should print "23-33 (bytes 24-34)"
+    str_regexFree(latency);
+
+    // Test str_matchAll extracting every key=value field
+    StrRegex* field = str_regexCompile("[a-z]+=[^ ]+");
+    StrMatch fields[8];
+    int count = str_matchAll(field, log, fields, 8);
+    printf("Field count: %d\n", count); // Should print 4
+    printf("Second field: %.*s\n", fields[1].byteEnd - fields[1].byteStart, log + fields[1].byteStart); // Should print "user=Zoë"
+    str_regexFree(field);
+
+    // Test alternation, lazy repeats and anchors
+    StrRegex* lazy = str_regexCompile("^(?:ts|user)=.+?-");
+    str_match(lazy, log, &match);
+    printf("Lazy match end: %d\n", match.end); // Should print 8
+    str_regexFree(lazy);
+
+    // Test that empty matches advance by one code point
+    StrRegex* empty = str_regexCompile("x*");
+    printf("Empty matches in 'aé': %d\n", str_matchAll(empty, "aé", NULL, 0)); // Should print 3
+    str_regexFree(empty);
+
+    // Test anchors in either order on empty input, where the start and end of the text coincide
+    StrRegex* endBegin = str_regexCompile("$^");
+    StrRegex* optionalEndBegin = str_regexCompile("(?:a?)$^");
+    printf("Search '$^' in '': %d\n", str_search(endBegin, "")); // Should print 0
+    printf("Search '(?:a?)$^' in '': %d\n", str_search(optionalEndBegin, "")); // Should print 0
+    printf("Search '$^' in 'a': %d\n", str_search(endBegin, "a")); // Should print -1
+    str_regexFree(endBegin);
+    str_regexFree(optionalEndBegin);
+
+    // Test no match and an invalid pattern
+    StrRegex* missing = str_regexCompile("status=5\\d\\d");
+    printf("Search missing: %d\n", str_search(missing, log)); // Should print -1
+    str_regexFree(missing);
+    printf("Invalid pattern: %d\n", str_regexCompile("a(b") == NULL && str_last_error == STR_ERROR_INVALID_PATTERN); // Should print 1
+}
+
+void test_ignore_case_cases() {
+    printf("\n=== Case-Insensitive Search Tests ===\n");
+
+    const char* header = "Content-Type: text/html; charset=UTF-8";
+
+    // Test the ASCII path
+    printf("IndexOf 'CONTENT-TYPE': %d\n", str_indexOfIgnoreCase(header, "CONTENT-TYPE")); // Should print 0
+    printf("IndexOf 'Charset=utf-8': %d\n", str_indexOfIgnoreCase(header, "Charset=utf-8")); // Should print 25
+    printf("Includes 'TEXT/XML': %d\n", str_includesIgnoreCase(header, "TEXT/XML")); // Should print 0
+
+    // Test non-ASCII simple case folding (indices are in code points)
+    printf("IndexOf 'ΣΟΦΊΑ' in 'η σοφία': %d\n", str_indexOfIgnoreCase("η σοφία", "ΣΟΦΊΑ")); // Should print 2
+    printf("IndexOf 'straße' in 'STRAẞE': %d\n", str_indexOfIgnoreCase("STRAẞE", "straße")); // Should print 0
+
+    // Test code points that fold to ASCII (KELVIN SIGN and LONG S)
+    printf("Includes '5k' in '5\u212A': %d\n", str_includesIgnoreCase("5\u212A", "5k")); // Should print 1
+    printf("IndexOf 'ss' in 'Meſs': %d\n", str_indexOfIgnoreCase("Meſs", "ss")); // Should print 2
+}
+
+void test_find_all_cases() {
+    printf("\n=== Find All Tests ===\n");
+
+    const char* text = "naïve café, café au lait, CAFÉ";
+    StrPosition positions[4];
+
+    // Test str_findAll (code point index and byte offset of each match)
+    int count = str_findAll(text, "café", false, positions, 4);
+    printf("Matches of 'café': %d\n", count); // Should print 2
+    printf("Second match: index %d, byte %d\n", positions[1].index, positions[1].byteOffset); // Should print "index 12, byte 14"
+
+    // Test overlapping and non-overlapping modes
+    printf("Count 'aa' in 'aaaa': %d\n", str_count("aaaa", "aa", false)); // Should print 2
+    printf("Overlapping count 'aa' in 'aaaa': %d\n", str_count("aaaa", "aa", true)); // Should print 3
+
+    // Test that the total is returned even when the array is full
+    printf("Count 'a' with room for one: %d\n", str_findAll(text, "a", false, positions, 1)); // Should print 5
+
+    // Test str_lastIndexOf with UTF-8
+    printf("Last index of 'café': %d\n", str_lastIndexOf(text, "café")); // Should print 12
+
+    // Test that ill-formed input is counted by maximal subpart, as str_charAt and str_indexOf do
+    const char* broken = "x\xE2\x82y\x80z";
+    StrPosition boundaries[8];
+    printf("Empty matches in broken text: %d\n", str_findAll(broken, "", false, boundaries, 8)); // Should print 6
+    printf("Boundary 3: index %d, byte %d\n", boundaries[3].index, boundaries[3].byteOffset); // Should print "index 3, byte 4"
+    printf("IndexOf 'z' in broken text: %d\n", str_indexOf(broken, "z")); // Should print 4
+}
+
+void test_iterator_cases() {
+    printf("\n=== Iterator Tests ===\n");
+
+    const char* text = "aé😀";
+    StrIter it;
+    int32_t codePoint;
+
+    // Test forward and backward steps
+    str_iterInit(&it, text);
+    printf("Forward:");
+    while ((codePoint = str_iterNext(&it)) != STR_ITER_END) printf(" U+%04X", (unsigned)codePoint);
+    printf("\n"); // Should print "Forward: U+0061 U+00E9 U+1F600"
+    printf("Backward:");
+    while ((codePoint = str_iterPrev(&it)) != STR_ITER_END) printf(" U+%04X", (unsigned)codePoint);
+    printf("\n"); // Should print "Backward: U+1F600 U+00E9 U+0061"
+
+    // Test that an ill-formed sequence yields U+FFFD and is stepped over
+    const char* broken = "x\xE2\x82y";
+    str_iterInitLength(&it, broken, strlen(broken));
+    printf("Ill-formed:");
+    while ((codePoint = str_iterNext(&it)) != STR_ITER_END) printf(" U+%04X", (unsigned)codePoint);
+    printf("\n"); // Should print "Ill-formed: U+0078 U+FFFD U+0079"
+    printf("Ill-formed backward:");
+    while ((codePoint = str_iterPrev(&it)) != STR_ITER_END) printf(" U+%04X", (unsigned)codePoint);
+    printf("\n"); // Should print "Ill-formed backward: U+0079 U+FFFD U+0078"
+
+    // Test str_codePointAt and that high bytes are not sign-extended
+    int value = 0;
+    str_codePointAt(text, 2, &value);
+    printf("Code point at 2: U+%04X\n", (unsigned)value); // Should print "U+1F600"
+    printf("Single high byte: %d\n", str_getCodePointFromBytes("\xE9", 1)); // Should print 233
+
+    // Test str_substring on multi-byte text
+    char result[32];
+    str_substring("Grüße, 世界", 2, 9, result);
+    printf("Substring(2, 9): %s\n", result); // Should print "üße, 世界"
+}
+
+void test_grapheme_cases() {
+    printf("\n=== Grapheme Cluster Tests ===\n");
+
+    // Test that combining marks, ZWJ sequences, skin tones and flags count as one character each
+    const char* text = "e\u0301👨‍👩‍👧‍👦👍🏽🇺🇸🇬🇧\r\nok";
+    printf("Code points: %d\n", str_length(text)); // Should print 19
+    printf("Graphemes: %d\n", str_graphemeLength(text)); // Should print 8
+    printf("Hangul jamo: %d\n", str_graphemeLength("\u1100\u1161\u11A8\uAC00")); // Should print 2
+    printf("Devanagari: %d\n", str_graphemeLength("नमस्ते")); // Should print 4
+
+    // Test str_graphemeAt
+    char* grapheme = str_graphemeAt(text, 1);
+    printf("Grapheme at 1: %s (%zu bytes)\n", grapheme, strlen(grapheme)); // Should print "👨‍👩‍👧‍👦 (25 bytes)"
+    free(grapheme);
+    grapheme = str_graphemeAt(text, 4);
+    printf("Grapheme at 4: %s\n", grapheme); // Should print "🇬🇧"
+    free(grapheme);
+    printf("Grapheme at 8: %s\n", str_graphemeAt(text, 8) ? "found" : "NULL"); // Should print "NULL"
+
+    // Test truncation that never splits a cluster
+    char result[64];
+    str_truncateGraphemes("Crème brûlée", 4, result, sizeof(result));
+    printf("Truncated to 4: %s\n", result); // Should print "Crèm"
+    str_truncateGraphemes("Cre\u0300me", 3, result, sizeof(result));
+    printf("Truncated combining: %s\n", result); // Should print "Crè"
+    printf("Small buffer: %d\n", str_truncateGraphemes(text, 2, result, 8)); // Should print 5 (STR_ERROR_BUFFER_TOO_SMALL)
+
+    // Test stepping through clusters with the iterator
+    StrIter it;
+    int clusterLen;
+    str_iterInit(&it, text);
+    printf("Cluster bytes:");
+    while ((clusterLen = str_iterNextGrapheme(&it)) != STR_ITER_END) printf(" %d", clusterLen);
+    printf("\n"); // Should print "Cluster bytes: 3 25 8 8 8 2 1 1"
+}
+
 int main() {
     test_ascii_cases();
     test_utf8_cases();
     test_utf8_with_emojis_cases();
+    test_dispatch_cases();
+    test_stats_cases();
+    test_normalization_cases();
+    test_well_formed_cases();
+    test_transcoding_cases();
+    test_regex_cases();
+    test_ignore_case_cases();
+    test_find_all_cases();
+    test_iterator_cases();
+    test_grapheme_cases();
 
     return 0;
 }